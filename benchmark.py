@@ -81,15 +81,32 @@ def plot_png_report(dataframe: pd.DataFrame) -> None:
     plt.savefig("./reports/comparison.png")
 
 
-def exec_process(binary: str, max_prime: int):
+def exec_process(binary: str, max_prime: int, args: list = ()):
     return subprocess.Popen(
-        ["gtime", "-v", f"./bin/{binary}", str(max_prime)],
+        ["gtime", "-v", f"./bin/{binary}", str(max_prime), *args],
         stdout=subprocess.DEVNULL,
         stderr=subprocess.PIPE,
         preexec_fn=os.setsid,
     )
 
 
+def parse_binaries(binaries: list) -> list:
+    # Binary entry is either a file name or {"name": ..., "binary": ..., "args": [...]}
+    # to benchmark one binary with different options (e.g. --engine=atkin)
+    parsed = []
+    for entry in binaries:
+        if isinstance(entry, str):
+            entry = {"name": entry, "binary": entry, "args": []}
+        parsed.append(
+            {
+                "name": entry.get("name", entry["binary"]),
+                "binary": entry["binary"],
+                "args": entry.get("args", []),
+            }
+        )
+    return parsed
+
+
 def check_binaries(binaries: list):
     # Check if all the required binaries exist in the specified bin directory.
     # Check if bin_dir is actually a directory
@@ -118,15 +135,16 @@ iterations = config["benchmark"]["iterations"]
 timeout = config["benchmark"]["timeout_seconds"]
 iterations_warmup = config["warmup"]["iterations"]
 timeout_warmup = config["warmup"]["timeout_seconds"]
-binaries = config["binaries"]
+binaries = parse_binaries(config["binaries"])
 
 
-if not check_binaries(binaries=binaries):
+if not check_binaries(binaries=[entry["binary"] for entry in binaries]):
     exit(-1)
 
 
 aggregated_data = []
-for binary in binaries:
+for entry in binaries:
+    binary = entry["name"]
     failed = False
     for max_prime in max_primes:
         if failed:
@@ -137,7 +155,9 @@ for binary in binaries:
 
         for _ in range(iterations_warmup):
             try:
-                process = exec_process(binary=binary, max_prime=max_prime)
+                process = exec_process(
+                    binary=entry["binary"], max_prime=max_prime, args=entry["args"]
+                )
                 process.communicate(timeout=timeout_warmup)
             except subprocess.TimeoutExpired:
                 failed = True
@@ -161,7 +181,9 @@ for binary in binaries:
             for _ in range(iterations):
                 try:
                     start_time = time.perf_counter()
-                    process = exec_process(binary=binary, max_prime=max_prime)
+                    process = exec_process(
+                        binary=entry["binary"], max_prime=max_prime, args=entry["args"]
+                    )
                     stdout_data, stderr_data = process.communicate(timeout=timeout)
                     exec_time = time.perf_counter() - start_time
                     result = stderr_data.decode("utf-8")
@@ -1,6 +1,293 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <climits>
+#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <set>
+#include <sstream>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <unistd.h>
+
+class AutoTuner {
+public:
+    // Thread count and segment sizes for this host: limited by the CPU affinity mask and the cgroup v2 CPU quota,
+    // segments sized to L1 data / L2 caches from /sys topology. calibrate() measures candidates and caches the winner
+    // per host, later runs reuse it while the detected limits stay the same.
+    struct Settings {
+        int threads = 1;
+        // Eratosthenes segments (L1 data cache) and Atkin segments (L2 cache)
+        uint64_t segmentBytes = 32 * 1024;
+        uint64_t atkinSegmentBytes = 256 * 1024;
+        // Detected limits
+        int availableCpus = 1;
+        int quotaCpus = 0;  // 0 when cpu.max is unlimited
+        int physicalCores = 1;
+        uint64_t l1DataBytes = 32 * 1024;
+        uint64_t l2Bytes = 256 * 1024;
+        bool tuned = false;
+    };
+
+    static Settings& settings() {
+        static Settings settings = load();
+        return settings;
+    }
+
+    static void calibrate();
+private:
+    static Settings load() {
+        Settings detected = detect();
+        std::ifstream file(cachePath());
+        Settings cached;
+        if (file >> cached.availableCpus >> cached.quotaCpus >> cached.physicalCores >> cached.l1DataBytes >> cached.l2Bytes
+                 >> cached.threads >> cached.segmentBytes >> cached.atkinSegmentBytes
+            && cached.availableCpus == detected.availableCpus && cached.quotaCpus == detected.quotaCpus
+            && cached.physicalCores == detected.physicalCores && cached.l1DataBytes == detected.l1DataBytes
+            && cached.l2Bytes == detected.l2Bytes && cached.threads > 0 && cached.threads <= detected.threads
+            && cached.segmentBytes > 0 && cached.segmentBytes % 8 == 0
+            && cached.atkinSegmentBytes > 0 && cached.atkinSegmentBytes % 8 == 0) {
+            cached.tuned = true;
+            return cached;
+        }
+        return detected;
+    }
+
+    static void save(const Settings& settings) {
+        std::string path = cachePath();
+        for (size_t separator = path.find('/', 1); separator != std::string::npos; separator = path.find('/', separator + 1)) {
+            mkdir(path.substr(0, separator).c_str(), 0755);
+        }
+        std::ofstream file(path, std::ios::trunc);
+        file << settings.availableCpus << " " << settings.quotaCpus << " " << settings.physicalCores << " "
+             << settings.l1DataBytes << " " << settings.l2Bytes << " "
+             << settings.threads << " " << settings.segmentBytes << " " << settings.atkinSegmentBytes << std::endl;
+    }
+
+    static std::string cachePath() {
+        const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+        const char* home = std::getenv("HOME");
+        std::string directory = cacheHome != nullptr ? cacheHome : std::string(home != nullptr ? home : "/tmp") + "/.cache";
+        char hostname[256] = {};
+        gethostname(hostname, sizeof(hostname) - 1);
+        return directory + "/PerformanceInvestigationCpp/tuning-" + hostname;
+    }
+
+    static Settings detect() {
+        Settings settings;
+        std::vector<int> cpus = affinityCpus();
+        settings.availableCpus = static_cast<int>(cpus.size());
+        settings.quotaCpus = cgroupQuotaCpus();
+        settings.threads = settings.quotaCpus > 0 ? std::min(settings.availableCpus, settings.quotaCpus) : settings.availableCpus;
+
+        // SMT siblings share a thread_siblings_list, count distinct lists among the allowed CPUs
+        std::set<std::string> cores;
+        for (int cpu : cpus) {
+            std::string siblings = readLine("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+            cores.insert(siblings.empty() ? std::to_string(cpu) : siblings);
+        }
+        settings.physicalCores = std::max(1, static_cast<int>(cores.size()));
+
+        std::string cacheDirectory = "/sys/devices/system/cpu/cpu" + std::to_string(cpus.front()) + "/cache/index";
+        for (int index = 0; index < 8; ++index) {
+            std::string level = readLine(cacheDirectory + std::to_string(index) + "/level");
+            std::string type = readLine(cacheDirectory + std::to_string(index) + "/type");
+            uint64_t size = parseSize(readLine(cacheDirectory + std::to_string(index) + "/size"));
+            if (size == 0) {
+                continue;
+            }
+            if (level == "1" && type == "Data") {
+                settings.l1DataBytes = size;
+            } else if (level == "2" && type != "Instruction") {
+                settings.l2Bytes = size;
+            }
+        }
+        settings.segmentBytes = settings.l1DataBytes / 8 * 8;
+        // A quarter of L2 measured best for Atkin toggles on a 2MB L2, smaller segments pay too much quadratic form setup
+        settings.atkinSegmentBytes = std::max<uint64_t>(settings.l2Bytes / 4, 256 * 1024) / 8 * 8;
+        return settings;
+    }
+
+    static std::vector<int> affinityCpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &cpuSet)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            for (int cpu = 0; cpu < std::max(1, static_cast<int>(std::thread::hardware_concurrency())); ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    static int cgroupQuotaCpus() {
+        // Effective quota is the smallest one along the cgroup v2 path ("0::/path" in /proc/self/cgroup),
+        // cpu.max holds "max <period>" or "<quota> <period>". Fractional CPUs are rounded down to keep threads within quota.
+        std::ifstream cgroups("/proc/self/cgroup");
+        std::string line;
+        std::string path;
+        while (std::getline(cgroups, line)) {
+            if (line.rfind("0::", 0) == 0) {
+                path = line.substr(3);
+            }
+        }
+        int quotaCpus = 0;
+        while (true) {
+            std::istringstream cpuMax(readLine("/sys/fs/cgroup" + path + "/cpu.max"));
+            std::string quota;
+            uint64_t period = 0;
+            if (cpuMax >> quota >> period && quota != "max" && period > 0) {
+                int cpus = std::max(1, static_cast<int>(std::stoull(quota) / period));
+                quotaCpus = quotaCpus == 0 ? cpus : std::min(quotaCpus, cpus);
+            }
+            if (path.empty() || path == "/") {
+                break;
+            }
+            path = path.substr(0, path.rfind('/'));
+        }
+        return quotaCpus;
+    }
+
+    static std::string readLine(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    static uint64_t parseSize(const std::string& size) {
+        // Cache sizes look like "48K" or "2048K"
+        if (size.empty() || !std::isdigit(static_cast<unsigned char>(size[0]))) {
+            return 0;
+        }
+        uint64_t value = std::stoull(size);
+        char unit = size.back();
+        return unit == 'K' ? value * 1024 : unit == 'M' ? value * 1024 * 1024 : value;
+    }
+};
+
+class SegmentSieve {
+public:
+    // Odd-only segments: bit i of a segment stands for number low + 2 * i (low is odd), set bit marks a prime.
+    // Segment of L1 data cache size (AutoTuner) keeps the working set inside it.
+    static uint64_t segmentBits() {
+        return AutoTuner::settings().segmentBytes * 8;
+    }
+
+    static uint64_t isqrt(uint64_t n) {
+        // Double precision estimate corrected to the exact floor(sqrt(n))
+        uint64_t root = std::min<uint64_t>(static_cast<uint64_t>(std::sqrt(static_cast<double>(n))), 0xFFFFFFFFULL);
+        while (root * root > n) {
+            --root;
+        }
+        while (root < 0xFFFFFFFFULL && (root + 1) * (root + 1) <= n) {
+            ++root;
+        }
+        return root;
+    }
+
+    static uint64_t ceilSqrt(uint64_t n) {
+        uint64_t root = isqrt(n);
+        return root * root < n ? root + 1 : root;
+    }
+
+    static std::vector<uint32_t> basePrimes(uint32_t limit) {
+        // Plain sieve for primes up to limit (including 2)
+        std::vector<uint32_t> primeNumbers;
+        if (limit < 2) {
+            return primeNumbers;
+        }
+        std::vector<bool> isPrime(limit + 1UL, true);
+        uint32_t sqrtLimit = static_cast<uint32_t>(isqrt(limit));
+        for (uint64_t candidate = 3; candidate <= sqrtLimit; candidate += 2) {
+            if (isPrime[candidate]) {
+                for (uint64_t primeMultiple = candidate * candidate; primeMultiple <= limit; primeMultiple += 2 * candidate) {
+                    isPrime[primeMultiple] = false;
+                }
+            }
+        }
+        primeNumbers.push_back(2);
+        for (uint64_t i = 3; i <= limit; i += 2) {
+            if (isPrime[i]) {
+                primeNumbers.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return primeNumbers;
+    }
+
+    static void sieve(uint64_t low, uint64_t bitsCount, const std::vector<uint32_t>& basePrimes, std::vector<uint64_t>& words) {
+        // Sieve odd numbers low, low + 2, ..., low + 2 * (bitsCount - 1) with base primes (must cover sqrt of the last one)
+        words.assign((bitsCount + 63) / 64, ~0ULL);
+        if (bitsCount % 64 != 0) {
+            words.back() = (1ULL << (bitsCount % 64)) - 1;
+        }
+        uint64_t high = low + 2 * (bitsCount - 1);
+        for (size_t i = 1; i < basePrimes.size(); ++i) {
+            uint64_t prime = basePrimes[i];
+            if (prime * prime > high) {
+                break;
+            }
+            // Offset of the first odd multiple of prime not below max(prime^2, low), kept relative to low
+            // so that ranges ending near 2^64 do not overflow
+            uint64_t startOffset = prime * prime > low ? prime * prime - low : (prime - low % prime) % prime;
+            // low is odd, so an odd offset gives an even multiple
+            if (startOffset % 2 == 1) {
+                startOffset += prime;
+            }
+            if (startOffset > high - low) {
+                continue;
+            }
+            for (uint64_t bit = startOffset / 2; bit < bitsCount; bit += prime) {
+                words[bit >> 6] &= ~(1ULL << (bit & 63));
+            }
+        }
+        // Number 1 is not a prime
+        if (low == 1) {
+            words[0] &= ~1ULL;
+        }
+    }
+
+    template <typename Callback>
+    static void forEachPrime(uint64_t low, const std::vector<uint64_t>& words, Callback callback) {
+        // Report set bits in increasing order
+        for (size_t wordIndex = 0; wordIndex < words.size(); ++wordIndex) {
+            uint64_t word = words[wordIndex];
+            while (word != 0) {
+                uint64_t bit = wordIndex * 64 + __builtin_ctzll(word);
+                callback(low + 2 * bit);
+                word &= word - 1;
+            }
+        }
+    }
+};
 
 class PrimeCalculator {
 public:
@@ -109,9 +396,52 @@ private:
             }
         }
     }
-private:
-    static int calculateThreadsNumber(int maxPrime) {
-        const int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+public:
+    static uint64_t countPrimes(uint64_t low, uint64_t high, int maxThreads = AutoTuner::settings().threads,
+                                uint64_t segmentBits = SegmentSieve::segmentBits()) {
+        // Count primes in [low, high] on odd-only bit-packed segments, works for 64-bit ranges
+        if (high < 2 || low > high) {
+            return 0;
+        }
+        uint64_t count = low <= 2 ? 1 : 0;
+        uint64_t firstOdd = std::max<uint64_t>(low, 3) | 1;
+        if (firstOdd > high) {
+            return count;
+        }
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(high)));
+
+        uint64_t oddNumbersCount = (high - firstOdd) / 2 + 1;
+        int num_threads = calculateThreadsNumber(static_cast<int>(std::min<uint64_t>(oddNumbersCount, INT_MAX)), maxThreads);
+        std::vector<std::thread> threads;
+        std::vector<uint64_t> segmentCounts(num_threads, 0);
+
+        uint64_t threadBits = (oddNumbersCount + num_threads - 1) / num_threads;
+        for (int i = 0; i < num_threads; ++i) {
+            uint64_t firstBit = i * threadBits;
+            uint64_t lastBit = std::min(oddNumbersCount, firstBit + threadBits);
+            threads.emplace_back([&, i, firstBit, lastBit]() {
+                std::vector<uint64_t> words;
+                for (uint64_t bit = firstBit; bit < lastBit; bit += segmentBits) {
+                    uint64_t bitsCount = std::min(segmentBits, lastBit - bit);
+                    SegmentSieve::sieve(firstOdd + 2 * bit, bitsCount, basePrimes, words);
+                    for (uint64_t word : words) {
+                        segmentCounts[i] += __builtin_popcountll(word);
+                    }
+                }
+            });
+        }
+
+        // Wait for threads to finish
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (uint64_t segmentCount : segmentCounts) {
+            count += segmentCount;
+        }
+        return count;
+    }
+public:
+    static int calculateThreadsNumber(int maxPrime, int maxThreads = AutoTuner::settings().threads) {
         // For small maxPrime Numbers
         int numThreads = maxPrime <= maxThreads ? 1 : std::min(static_cast<int>(maxPrime/maxThreads), maxThreads);
         //std::cout << "Threads number is " << numThreads << std::endl;
@@ -119,8 +449,2129 @@ private:
     }
 };
 
-int main(int argc, char **argv) {
-    std::vector<int> primeNumbers = PrimeCalculator::getPrimes(std::stoi(argv[1]));
+void AutoTuner::calibrate() {
+    // Time counting primes up to 2^27 for thread counts (physical cores, all allowed CPUs)
+    // and segment sizes around L1 data / L2 caches, keep the fastest combination
+    Settings best = detect();
+    std::set<int> threadCandidates = {std::min(best.threads, best.physicalCores), best.threads};
+    std::set<uint64_t> segmentCandidates = {best.l1DataBytes / 8 * 8, best.l2Bytes / 16 * 8, best.l2Bytes / 8 * 8};
+    double bestSeconds = 0;
+    for (int threads : threadCandidates) {
+        for (uint64_t segmentBytes : segmentCandidates) {
+            double seconds = 0;
+            for (int iteration = 0; iteration < 2; ++iteration) {
+                auto start = std::chrono::steady_clock::now();
+                PrimeCalculator::countPrimes(0, 1 << 27, threads, segmentBytes * 8);
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                seconds = iteration == 0 ? elapsed : std::min(seconds, elapsed);
+            }
+            if (bestSeconds == 0 || seconds < bestSeconds) {
+                bestSeconds = seconds;
+                best.threads = threads;
+                best.segmentBytes = segmentBytes;
+            }
+        }
+    }
+    best.tuned = true;
+    settings() = best;
+    save(best);
+}
+
+class PrimeGenerator {
+public:
+    // Lazy generator of primes in increasing order: segments are sieved only when the previous one is consumed,
+    // so stopping early costs only the segments actually reached
+    uint64_t next() {
+        if (!twoReported_) {
+            twoReported_ = true;
+            return 2;
+        }
+        while (true) {
+            while (wordIndex_ < words_.size()) {
+                uint64_t& word = words_[wordIndex_];
+                if (word != 0) {
+                    uint64_t bit = wordIndex_ * 64 + __builtin_ctzll(word);
+                    word &= word - 1;
+                    return segmentLow_ + 2 * bit;
+                }
+                ++wordIndex_;
+            }
+            sieveNextSegment();
+        }
+    }
+private:
+    void sieveNextSegment() {
+        segmentLow_ = nextLow_;
+        uint64_t segmentHigh = segmentLow_ + 2 * (SegmentSieve::segmentBits() - 1);
+        // Grow base primes list geometrically once the segment passes the square of its limit
+        if (basePrimesLimit_ * basePrimesLimit_ < segmentHigh) {
+            basePrimesLimit_ = std::max(2 * basePrimesLimit_, SegmentSieve::isqrt(segmentHigh) + 1);
+            basePrimes_ = SegmentSieve::basePrimes(static_cast<uint32_t>(basePrimesLimit_));
+        }
+        SegmentSieve::sieve(segmentLow_, SegmentSieve::segmentBits(), basePrimes_, words_);
+        wordIndex_ = 0;
+        nextLow_ = segmentHigh + 2;
+    }
+
+    bool twoReported_ = false;
+    uint64_t nextLow_ = 1;
+    uint64_t segmentLow_ = 1;
+    uint64_t basePrimesLimit_ = 0;
+    std::vector<uint32_t> basePrimes_;
+    std::vector<uint64_t> words_;
+    size_t wordIndex_ = 0;
+};
+
+class PipelinedSieve {
+public:
+    // Workers sieve segments ahead and publish them into a bounded ring indexed by segment number,
+    // the calling thread drains the ring strictly in order. First primes arrive after a single segment
+    // and memory stays bounded by ring depth.
+    template <typename Callback>
+    static void run(uint64_t maxPrime, Callback callback, int numThreads, size_t ringDepth,
+                    uint64_t segmentBits = SegmentSieve::segmentBits()) {
+        if (maxPrime < 2) {
+            return;
+        }
+        callback(2);
+
+        uint64_t oddNumbersCount = maxPrime / 2 + maxPrime % 2;
+        uint64_t segmentsCount = (oddNumbersCount + segmentBits - 1) / segmentBits;
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(maxPrime)));
+
+        // Slot sequence is 2 * k while the slot is free for segment k and 2 * k + 1 once segment k is published
+        ringDepth = std::max<size_t>(ringDepth, 1);
+        std::unique_ptr<Slot[]> ring(new Slot[ringDepth]);
+        for (size_t i = 0; i < ringDepth; ++i) {
+            ring[i].sequence.store(2 * i, std::memory_order_relaxed);
+        }
+        std::atomic<uint64_t> nextSegment(0);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; ++i) {
+            threads.emplace_back(produceSegments, maxPrime, segmentBits, segmentsCount,
+                                 std::cref(basePrimes), ring.get(), ringDepth, std::ref(nextSegment));
+        }
+
+        for (uint64_t segment = 0; segment < segmentsCount; ++segment) {
+            Slot& slot = ring[segment % ringDepth];
+            while (slot.sequence.load(std::memory_order_acquire) != 2 * segment + 1) {
+                std::this_thread::yield();
+            }
+            SegmentSieve::forEachPrime(segmentLow(segment, segmentBits), slot.words, callback);
+            slot.sequence.store(2 * (segment + ringDepth), std::memory_order_release);
+        }
+
+        // Wait for threads to finish
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        std::vector<uint64_t> words;
+    };
+
+    static uint64_t segmentLow(uint64_t segment, uint64_t segmentBits) {
+        return 1 + 2 * segment * segmentBits;
+    }
+
+    static void produceSegments(uint64_t maxPrime, uint64_t segmentBits, uint64_t segmentsCount, const std::vector<uint32_t>& basePrimes,
+                                Slot* ring, size_t ringDepth, std::atomic<uint64_t>& nextSegment) {
+        while (true) {
+            uint64_t segment = nextSegment.fetch_add(1, std::memory_order_relaxed);
+            if (segment >= segmentsCount) {
+                return;
+            }
+            Slot& slot = ring[segment % ringDepth];
+            // Ring is full: wait for the consumer to drain segment - ringDepth
+            while (slot.sequence.load(std::memory_order_acquire) != 2 * segment) {
+                std::this_thread::yield();
+            }
+            uint64_t low = segmentLow(segment, segmentBits);
+            uint64_t bitsCount = std::min<uint64_t>(segmentBits, (maxPrime - low) / 2 + 1);
+            SegmentSieve::sieve(low, bitsCount, basePrimes, slot.words);
+            slot.sequence.store(2 * segment + 1, std::memory_order_release);
+        }
+    }
+};
+
+class AtkinCalculator {
+public:
+    // Segmented sieve of Atkin, alternative backend to the Eratosthenes sieve in PrimeCalculator.
+    // Segments use the SegmentSieve odd-only layout, so outputs are produced by the same bit scanning.
+    // Segments of L2 cache size (AutoTuner) amortise the per-segment quadratic form setup.
+    static uint64_t segmentBits() {
+        return AutoTuner::settings().atkinSegmentBytes * 8;
+    }
+    // Keeps 3 * x^2 of the quadratic forms within 64 bits
+    static constexpr uint64_t kMaxHigh = 1ULL << 62;
+    // 64MB of bits per thread at most
+    static constexpr uint64_t kMaxSegmentBits = 1ULL << 29;
+
+    static std::vector<int> getPrimes(int maxPrime) {
+        std::vector<int> primeNumbers;
+
+        if (maxPrime < 2) {
+            return primeNumbers;
+        }
+
+        // Quadratic forms only produce primes from 5, process 2 and 3 separately
+        primeNumbers.push_back(2);
+        if (maxPrime >= 3) {
+            primeNumbers.push_back(3);
+        }
+        if (maxPrime < 5) {
+            return primeNumbers;
+        }
+
+        int num_threads = PrimeCalculator::calculateThreadsNumber(maxPrime);
+        std::vector<std::vector<int> > primeNumbersSegments(num_threads);
+        sieveRange(5, maxPrime, num_threads, [&primeNumbersSegments](int thread, uint64_t low, const std::vector<uint64_t>& words) {
+            SegmentSieve::forEachPrime(low, words, [&primeNumbersSegments, thread](uint64_t prime) {
+                primeNumbersSegments[thread].push_back(static_cast<int>(prime));
+            });
+        });
+
+        size_t primeNumbersCount = primeNumbers.size();
+        for (const auto& primeNumbersSegment : primeNumbersSegments) {
+            primeNumbersCount += primeNumbersSegment.size();
+        }
+        primeNumbers.reserve(primeNumbersCount);
+        for (const auto& primeNumbersSegment : primeNumbersSegments) {
+            primeNumbers.insert(primeNumbers.end(), primeNumbersSegment.begin(), primeNumbersSegment.end());
+        }
+        return primeNumbers;
+    }
+
+    static uint64_t countPrimes(uint64_t low, uint64_t high) {
+        // Count primes in [low, high], high must stay below kMaxHigh
+        if (high < 2 || low > high) {
+            return 0;
+        }
+        uint64_t count = (low <= 2 ? 1 : 0) + (low <= 3 && high >= 3 ? 1 : 0);
+        uint64_t firstOdd = std::max<uint64_t>(low, 5) | 1;
+        if (firstOdd > high) {
+            return count;
+        }
+
+        uint64_t oddNumbersCount = (high - firstOdd) / 2 + 1;
+        int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<uint64_t>(oddNumbersCount, INT_MAX)));
+        std::vector<uint64_t> segmentCounts(num_threads, 0);
+        sieveRange(firstOdd, high, num_threads, [&segmentCounts](int thread, uint64_t, const std::vector<uint64_t>& words) {
+            for (uint64_t word : words) {
+                segmentCounts[thread] += __builtin_popcountll(word);
+            }
+        });
+        for (uint64_t segmentCount : segmentCounts) {
+            count += segmentCount;
+        }
+        return count;
+    }
+private:
+    template <typename Callback>
+    static void sieveRange(uint64_t low, uint64_t high, int numThreads, Callback callback) {
+        // Split odd numbers of [low, high] (low is odd and at least 5) into contiguous per-thread chunks
+        // and report every sieved segment of a chunk in order to callback(thread, segmentLow, words)
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(high)));
+        uint64_t oddNumbersCount = (high - low) / 2 + 1;
+        uint64_t threadBits = (oddNumbersCount + numThreads - 1) / numThreads;
+        std::vector<std::thread> threads;
+
+        // Quadratic form setup walks O(sqrt(high)) values of x per segment, at high offsets segments grow
+        // to 2 * sqrt(high) bits (up to kMaxSegmentBits) so that the setup does not dominate sieving
+        uint64_t rangeSegmentBits = std::max(segmentBits(), std::min(kMaxSegmentBits, (2 * SegmentSieve::isqrt(high) + 63) / 64 * 64));
+
+        for (int i = 0; i < numThreads; ++i) {
+            uint64_t firstBit = i * threadBits;
+            uint64_t lastBit = std::min(oddNumbersCount, firstBit + threadBits);
+            threads.emplace_back([&, i, firstBit, lastBit]() {
+                std::vector<uint64_t> words;
+                for (uint64_t bit = firstBit; bit < lastBit; bit += rangeSegmentBits) {
+                    uint64_t segmentLow = low + 2 * bit;
+                    sieveSegment(segmentLow, std::min(rangeSegmentBits, lastBit - bit), basePrimes, words);
+                    callback(i, segmentLow, words);
+                }
+            });
+        }
+
+        // Wait for threads to finish
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    static void sieveSegment(uint64_t low, uint64_t bitsCount, const std::vector<uint32_t>& basePrimes, std::vector<uint64_t>& words) {
+        // Atkin sieve of odd numbers low, low + 2, ..., low + 2 * (bitsCount - 1), low is odd and at least 5
+        words.assign((bitsCount + 63) / 64, 0);
+        uint64_t high = low + 2 * (bitsCount - 1);
+        auto toggle = [&words, low](uint64_t number) {
+            uint64_t bit = (number - low) / 2;
+            words[bit >> 6] ^= 1ULL << (bit & 63);
+        };
+
+        // n = 4x^2 + y^2, n mod 12 in {1, 5}: y is odd (n odd) which gives n = 1 mod 4, so only n mod 3 is left to check.
+        // Any x with 4x^2 < high can reach the segment with a large enough y, so x always starts from 1
+        for (uint64_t x = 1, xMax = SegmentSieve::isqrt((high - 1) / 4); x <= xMax; ++x) {
+            uint64_t base = 4 * x * x;
+            uint64_t y = base >= low ? 1 : SegmentSieve::ceilSqrt(low - base);
+            y |= 1;
+            for (uint64_t number = base + y * y; number <= high; y += 2, number = base + y * y) {
+                if (number % 3 != 0) {
+                    toggle(number);
+                }
+            }
+        }
+
+        // n = 3x^2 + y^2, n mod 12 = 7: x is odd and y is even (n = 3 mod 4), n = 1 mod 3 unless y is a multiple of 3
+        for (uint64_t x = 1, xMax = SegmentSieve::isqrt((high - 4) / 3); x <= xMax; x += 2) {
+            uint64_t base = 3 * x * x;
+            uint64_t y = base + 4 >= low ? 2 : SegmentSieve::ceilSqrt(low - base);
+            y += y & 1;
+            for (uint64_t number = base + y * y; number <= high; y += 2, number = base + y * y) {
+                if (y % 3 != 0) {
+                    toggle(number);
+                }
+            }
+        }
+
+        // n = 3x^2 - y^2 with x > y, n mod 12 = 11: x and y have opposite parity (n = 3 mod 4),
+        // n = 2 mod 3 unless y is a multiple of 3. The largest value for a given x is 3x^2 - 1, so x starts
+        // above sqrt(low / 3); the smallest one is 2x^2 + 2x - 1 (y = x - 1), which bounds x from above
+        for (uint64_t x = std::max<uint64_t>(2, SegmentSieve::isqrt(low / 3) + 1); 2 * x * x + 2 * x - 1 <= high; ++x) {
+            uint64_t base = 3 * x * x;
+            if (base <= low) {
+                continue;
+            }
+            uint64_t yMax = std::min(x - 1, SegmentSieve::isqrt(base - low));
+            uint64_t y = base > high ? SegmentSieve::ceilSqrt(base - high) : 1;
+            if ((y & 1) == (x & 1)) {
+                ++y;
+            }
+            for (; y <= yMax; y += 2) {
+                if (y % 3 != 0) {
+                    toggle(base - y * y);
+                }
+            }
+        }
+
+        // Eliminate multiples of squares of primes from 5, odd multiples of p^2 are p^2 numbers apart in bits
+        for (size_t i = 2; i < basePrimes.size(); ++i) {
+            uint64_t square = static_cast<uint64_t>(basePrimes[i]) * basePrimes[i];
+            if (square > high) {
+                break;
+            }
+            uint64_t startNumber = std::max(square, (low + square - 1) / square * square);
+            if (startNumber % 2 == 0) {
+                startNumber += square;
+            }
+            for (uint64_t bit = (startNumber - low) / 2; bit < bitsCount; bit += square) {
+                words[bit >> 6] &= ~(1ULL << (bit & 63));
+            }
+        }
+    }
+};
+
+class PrimeAnalytics {
+public:
+    // Prime constellations and gaps computed on the bit-packed segments, the prime list is never materialised.
+    // Constellation offsets are even, so offset d is a shift by d / 2 bits in the odd-only layout.
+    struct Pattern {
+        const char* name;
+        std::vector<int> offsets;
+    };
+
+    static const std::vector<Pattern>& patterns() {
+        static const std::vector<Pattern> patterns = {
+            {"twin (p, p+2)", {2}},
+            {"cousin (p, p+4)", {4}},
+            {"sexy (p, p+6)", {6}},
+            {"triplet (p, p+2, p+6)", {2, 6}},
+            {"triplet (p, p+4, p+6)", {4, 6}},
+            {"quadruplet (p, p+2, p+6, p+8)", {2, 6, 8}},
+        };
+        return patterns;
+    }
+
+    struct Result {
+        uint64_t primesCount = 0;
+        uint64_t firstPrime = 0;
+        uint64_t lastPrime = 0;
+        std::vector<uint64_t> patternCounts = std::vector<uint64_t>(patterns().size(), 0);
+        std::vector<uint64_t> patternFirst = std::vector<uint64_t>(patterns().size(), 0);
+        // gapHistogram[g] is the number of consecutive primes exactly g apart
+        std::vector<uint64_t> gapHistogram;
+        uint64_t maxGap = 0;
+        uint64_t maxGapStart = 0;
+
+        void addGap(uint64_t previousPrime, uint64_t prime) {
+            uint64_t gap = prime - previousPrime;
+            if (gapHistogram.size() <= gap) {
+                gapHistogram.resize(gap + 1, 0);
+            }
+            ++gapHistogram[gap];
+            if (gap > maxGap) {
+                maxGap = gap;
+                maxGapStart = previousPrime;
+            }
+        }
+
+        void append(const Result& next) {
+            // Merge results of the range directly following this one
+            if (next.primesCount == 0) {
+                return;
+            }
+            if (primesCount == 0) {
+                *this = next;
+                return;
+            }
+            // Gap across the boundary goes first to keep the earliest maximal gap
+            addGap(lastPrime, next.firstPrime);
+            if (next.maxGap > maxGap) {
+                maxGap = next.maxGap;
+                maxGapStart = next.maxGapStart;
+            }
+            if (gapHistogram.size() < next.gapHistogram.size()) {
+                gapHistogram.resize(next.gapHistogram.size(), 0);
+            }
+            for (size_t gap = 0; gap < next.gapHistogram.size(); ++gap) {
+                gapHistogram[gap] += next.gapHistogram[gap];
+            }
+            for (size_t i = 0; i < patternCounts.size(); ++i) {
+                if (patternCounts[i] == 0) {
+                    patternFirst[i] = next.patternFirst[i];
+                }
+                patternCounts[i] += next.patternCounts[i];
+            }
+            primesCount += next.primesCount;
+            lastPrime = next.lastPrime;
+        }
+    };
+
+    static Result analyse(uint64_t low, uint64_t high) {
+        // Statistics of primes in [low, high], constellations are counted by their first prime and must fit in range
+        Result result;
+        if (high < 2 || low > high) {
+            return result;
+        }
+        if (low <= 2) {
+            result.primesCount = 1;
+            result.firstPrime = 2;
+            result.lastPrime = 2;
+        }
+        uint64_t firstOdd = std::max<uint64_t>(low, 1) | 1;
+        if (firstOdd > high) {
+            return result;
+        }
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(high)));
+
+        // Per-thread chunks are whole words, so every word belongs to exactly one segment
+        uint64_t oddNumbersCount = (high - firstOdd) / 2 + 1;
+        int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<uint64_t>(oddNumbersCount, INT_MAX)));
+        uint64_t threadBits = ((oddNumbersCount + num_threads - 1) / num_threads + 63) / 64 * 64;
+        std::vector<std::thread> threads;
+        std::vector<Result> threadResults(num_threads);
+
+        for (int i = 0; i < num_threads; ++i) {
+            uint64_t firstBit = std::min(oddNumbersCount, i * threadBits);
+            uint64_t lastBit = std::min(oddNumbersCount, firstBit + threadBits);
+            threads.emplace_back([&, i, firstBit, lastBit]() {
+                std::vector<uint64_t> words;
+                for (uint64_t bit = firstBit; bit < lastBit; bit += SegmentSieve::segmentBits()) {
+                    uint64_t segmentEnd = std::min(lastBit, bit + SegmentSieve::segmentBits());
+                    // One extra word of lookahead completes constellations starting near the segment end
+                    uint64_t sievedEnd = std::min(oddNumbersCount, segmentEnd + 64);
+                    SegmentSieve::sieve(firstOdd + 2 * bit, sievedEnd - bit, basePrimes, words);
+                    threadResults[i].append(analyseSegment(firstOdd + 2 * bit, segmentEnd - bit, words));
+                }
+            });
+        }
+
+        // Wait for threads to finish
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const Result& threadResult : threadResults) {
+            result.append(threadResult);
+        }
+        return result;
+    }
+private:
+    static Result analyseSegment(uint64_t low, uint64_t bitsCount, const std::vector<uint64_t>& words) {
+        // Segment owns the first bitsCount bits (whole words unless it ends the range), the rest is lookahead
+        Result result;
+        size_t ownedWords = (bitsCount + 63) / 64;
+
+        // Constellations: AND of the bitmap with its copies shifted by offset / 2 bits
+        for (size_t patternIndex = 0; patternIndex < patterns().size(); ++patternIndex) {
+            const std::vector<int>& offsets = patterns()[patternIndex].offsets;
+            for (size_t wordIndex = 0; wordIndex < ownedWords; ++wordIndex) {
+                uint64_t nextWord = wordIndex + 1 < words.size() ? words[wordIndex + 1] : 0;
+                uint64_t matches = words[wordIndex];
+                for (int offset : offsets) {
+                    int shift = offset / 2;
+                    matches &= (words[wordIndex] >> shift) | (nextWord << (64 - shift));
+                }
+                if (matches == 0) {
+                    continue;
+                }
+                if (result.patternCounts[patternIndex] == 0) {
+                    result.patternFirst[patternIndex] = low + 2 * (wordIndex * 64 + __builtin_ctzll(matches));
+                }
+                result.patternCounts[patternIndex] += __builtin_popcountll(matches);
+            }
+        }
+
+        // Gaps between consecutive primes of the segment
+        for (size_t wordIndex = 0; wordIndex < ownedWords; ++wordIndex) {
+            uint64_t word = words[wordIndex];
+            while (word != 0) {
+                uint64_t prime = low + 2 * (wordIndex * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+                if (result.primesCount == 0) {
+                    result.firstPrime = prime;
+                } else {
+                    result.addGap(result.lastPrime, prime);
+                }
+                result.lastPrime = prime;
+                ++result.primesCount;
+            }
+        }
+        return result;
+    }
+};
+
+class PrimeSums {
+public:
+    // Lucy_Hedgehog algorithm: S(v) = sum of f(p) over primes p <= v for every v = n / i, O(n^(3/4)) time and O(sqrt(n)) memory.
+    // S(v) starts as the sum of f(j) over 2 <= j <= v, sieving prime p removes f(p) * (S(v / p) - S(p - 1)) from every v >= p^2.
+    static unsigned __int128 sumPrimes(uint64_t n) {
+        // Exact sum of primes up to n, fits in 128 bits far beyond the supported memory range (n up to about 10^14)
+        return lucy<unsigned __int128>(n,
+            [](uint64_t v) { return static_cast<unsigned __int128>(v) * (v + 1) / 2 - 1; },
+            [](uint64_t prime) { return prime; },
+            [](unsigned __int128 value, uint64_t prime, unsigned __int128 quotientValue, unsigned __int128 previousValue) {
+                return value - prime * (quotientValue - previousValue);
+            });
+    }
+
+    static uint64_t powerSumModulo(uint64_t n, int power, uint64_t modulus) {
+        // Sum of p^power (power from 0 to 3) over primes up to n, modulo modulus
+        auto mulMod = [modulus](uint64_t a, uint64_t b) {
+            return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % modulus);
+        };
+        auto subMod = [modulus](uint64_t a, uint64_t b) {
+            return a >= b ? a - b : a + (modulus - b);
+        };
+        uint64_t one = 1 % modulus;
+        return lucy<uint64_t>(n,
+            [=](uint64_t v) {
+                // Closed forms of sum of j^power over 1 <= j <= v, dividing exactly before reducing
+                uint64_t a = v;
+                uint64_t b = v + 1;
+                uint64_t c = 2 * v + 1;
+                uint64_t sum = 0;
+                if (power == 0) {
+                    sum = v % modulus;
+                } else if (power == 1 || power == 3) {
+                    (a % 2 == 0 ? a : b) /= 2;
+                    sum = mulMod(a % modulus, b % modulus);
+                    if (power == 3) {
+                        sum = mulMod(sum, sum);
+                    }
+                } else {
+                    (a % 2 == 0 ? a : b) /= 2;
+                    (a % 3 == 0 ? a : (b % 3 == 0 ? b : c)) /= 3;
+                    sum = mulMod(mulMod(a % modulus, b % modulus), c % modulus);
+                }
+                return subMod(sum, one);
+            },
+            [=](uint64_t prime) {
+                // p^power mod m once per prime, with its Shoup quotient floor(weight * 2^64 / m) so that
+                // key updates multiply by it without a 128-bit division (exact for m below 2^63)
+                Weight weight = {one, 0};
+                for (int i = 0; i < power; ++i) {
+                    weight.value = mulMod(weight.value, prime % modulus);
+                }
+                if (modulus < (1ULL << 63)) {
+                    weight.shoup = static_cast<uint64_t>((static_cast<unsigned __int128>(weight.value) << 64) / modulus);
+                }
+                return weight;
+            },
+            [=](uint64_t value, const Weight& weight, uint64_t quotientValue, uint64_t previousValue) {
+                uint64_t difference = subMod(quotientValue, previousValue);
+                if (modulus >= (1ULL << 63)) {
+                    return subMod(value, mulMod(weight.value, difference));
+                }
+                uint64_t quotient = static_cast<uint64_t>(static_cast<unsigned __int128>(difference) * weight.shoup >> 64);
+                uint64_t product = weight.value * difference - quotient * modulus;
+                return subMod(value, product >= modulus ? product - modulus : product);
+            });
+    }
+private:
+    // Below this many keys a level is updated on the calling thread
+    static constexpr size_t kMinParallelKeys = 1 << 15;
+
+    struct Weight {
+        uint64_t value;
+        uint64_t shoup;
+    };
+
+    template <typename Value, typename Init, typename PrimeWeight, typename Update>
+    static Value lucy(uint64_t n, Init init, PrimeWeight primeWeight, Update update) {
+        if (n < 2) {
+            return Value(0);
+        }
+        // Keys in decreasing order: n / 1, ..., n / largeCount (all above sqrtN), then sqrtN, ..., 1
+        uint64_t sqrtN = SegmentSieve::isqrt(n);
+        uint64_t largeCount = n / (sqrtN + 1);
+        size_t keysCount = largeCount + sqrtN;
+        auto key = [&](size_t index) {
+            return index < largeCount ? n / (index + 1) : sqrtN - (index - largeCount);
+        };
+        auto indexOf = [&](uint64_t v) {
+            return v > sqrtN ? n / v - 1 : largeCount + sqrtN - v;
+        };
+        auto keysNotBelow = [&](uint64_t v) {
+            return v > sqrtN ? std::min<uint64_t>(largeCount, n / v) : largeCount + sqrtN - v + 1;
+        };
+
+        std::vector<Value> values(keysCount);
+        for (size_t i = 0; i < keysCount; ++i) {
+            values[i] = init(key(i));
+        }
+
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(sqrtN));
+        for (uint64_t prime : basePrimes) {
+            Value previousValue = values[indexOf(prime - 1)];
+            auto weight = primeWeight(prime);
+            auto updateKeys = [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i) {
+                    // Quotient of a large key n / (i + 1) by prime is again a large key while (i + 1) * prime <= largeCount
+                    uint64_t quotientIndex = i < largeCount && (i + 1) * prime <= largeCount
+                                             ? (i + 1) * prime - 1 : indexOf(key(i) / prime);
+                    values[i] = update(values[i], weight, values[quotientIndex], previousValue);
+                }
+            };
+
+            // Keys in [prime^j, prime^(j+1)) read values of keys in [prime^(j-1), prime^j) only.
+            // Updating levels from the highest one keeps those reads unmodified and makes every level parallel.
+            // levelBounds[k] is the number of keys not below prime^(k+2), i.e. the end of that level.
+            std::vector<size_t> levelBounds;
+            for (uint64_t power = prime * prime; ; power *= prime) {
+                levelBounds.push_back(keysNotBelow(power));
+                if (power > n / prime) {
+                    break;
+                }
+            }
+            levelBounds.push_back(0);
+            for (size_t level = levelBounds.size() - 1; level > 0; --level) {
+                size_t levelBegin = levelBounds[level];
+                size_t levelEnd = levelBounds[level - 1];
+                size_t levelSize = levelEnd - levelBegin;
+                if (levelSize < kMinParallelKeys) {
+                    updateKeys(levelBegin, levelEnd);
+                    continue;
+                }
+                int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<size_t>(levelSize, INT_MAX)));
+                std::vector<std::thread> threads;
+                size_t chunkSize = (levelSize + num_threads - 1) / num_threads;
+                for (size_t first = levelBegin; first < levelEnd; first += chunkSize) {
+                    threads.emplace_back(updateKeys, first, std::min(levelEnd, first + chunkSize));
+                }
+                // Wait for threads to finish
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+            }
+        }
+        return values[0];
+    }
+};
+
+class SmallestPrimeFactorTable {
+public:
+    // Smallest prime factor of every odd number up to limit (below 2^32), 0 marks primes.
+    // Factors of odd composites are at most sqrt(2^32), so uint16_t entries suffice: memory is about limit bytes.
+    // Even numbers are handled by counting trailing zero bits.
+    struct Factorization {
+        // Prime factors (ascending, with multiplicity) of values[i] are factors[offsets[i]] ... factors[offsets[i + 1] - 1]
+        std::vector<uint32_t> factors;
+        std::vector<uint32_t> offsets;
+    };
+
+    explicit SmallestPrimeFactorTable(uint32_t limit) : limit_(limit), entries_(limit / 2 + 1, 0) {
+        // Segmented sieve over table entries: primes are applied in increasing order, so the first one to mark an entry is the smallest
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(limit)));
+        uint64_t entriesCount = entries_.size();
+        int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<uint64_t>(entriesCount, INT_MAX)));
+        uint64_t threadEntries = (entriesCount + num_threads - 1) / num_threads;
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < num_threads; ++i) {
+            uint64_t firstEntry = std::min(entriesCount, i * threadEntries);
+            uint64_t lastEntry = std::min(entriesCount, firstEntry + threadEntries);
+            threads.emplace_back([this, &basePrimes, firstEntry, lastEntry]() {
+                for (uint64_t segmentStart = firstEntry; segmentStart < lastEntry; segmentStart += kSegmentEntries) {
+                    sieveSegment(segmentStart, std::min(lastEntry, segmentStart + kSegmentEntries), basePrimes);
+                }
+            });
+        }
+
+        // Wait for threads to finish
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    template <typename Callback>
+    void forEachFactor(uint32_t number, Callback callback) const {
+        // Prime factors of number <= limit in ascending order, values 0 and 1 have none
+        assert(number <= limit_ && "number exceeds the table limit");
+        if (number == 0) {
+            return;
+        }
+        for (int twos = __builtin_ctz(number); twos > 0; --twos) {
+            callback(2);
+        }
+        number >>= __builtin_ctz(number);
+        while (number > 1) {
+            uint16_t entry = entries_[number / 2];
+            if (entry == 0) {
+                callback(number);
+                return;
+            }
+            callback(entry);
+            number /= entry;
+        }
+    }
+
+    bool factorize(const uint32_t* values, size_t count, Factorization& factorization) const {
+        // Batch factorisation of values <= limit over contiguous chunks in parallel. A first pass counts the factors
+        // of every value, so factors and offsets are allocated once at their exact size and the second pass writes
+        // each chunk straight into its slice. False when there are 2^32 factors or more (32-bit offsets).
+        factorization.offsets.assign(count + 1, 0);
+        factorization.factors.clear();
+        if (count == 0) {
+            return true;
+        }
+
+        int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<size_t>(count, INT_MAX)));
+        size_t chunkSize = (count + num_threads - 1) / num_threads;
+        auto forEachChunk = [&](auto chunkPass) {
+            std::vector<std::thread> threads;
+            for (size_t first = 0; first < count; first += chunkSize) {
+                threads.emplace_back(chunkPass, first, std::min(count, first + chunkSize));
+            }
+            // Wait for threads to finish
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        };
+
+        uint32_t* offsets = factorization.offsets.data();
+        forEachChunk([this, values, offsets](size_t first, size_t last) {
+            for (size_t j = first; j < last; ++j) {
+                uint32_t factorsNumber = 0;
+                forEachFactor(values[j], [&factorsNumber](uint32_t) { ++factorsNumber; });
+                offsets[j + 1] = factorsNumber;
+            }
+        });
+
+        uint64_t factorsCount = 0;
+        for (size_t j = 1; j <= count; ++j) {
+            factorsCount += offsets[j];
+            if (factorsCount > UINT32_MAX) {
+                return false;
+            }
+            offsets[j] = static_cast<uint32_t>(factorsCount);
+        }
+        factorization.factors.resize(factorsCount);
+
+        uint32_t* factors = factorization.factors.data();
+        forEachChunk([this, values, offsets, factors](size_t first, size_t last) {
+            uint32_t* output = factors + offsets[first];
+            for (size_t j = first; j < last; ++j) {
+                forEachFactor(values[j], [&output](uint32_t factor) { *output++ = factor; });
+            }
+        });
+        return true;
+    }
+
+    bool factorize(const std::vector<uint32_t>& values, Factorization& factorization) const {
+        return factorize(values.data(), values.size(), factorization);
+    }
+private:
+    // 64KB of entries per segment
+    static constexpr uint64_t kSegmentEntries = 32 * 1024;
+
+    void sieveSegment(uint64_t firstEntry, uint64_t lastEntry, const std::vector<uint32_t>& basePrimes) {
+        // Entry e stands for number 2 * e + 1, odd multiples of p are p entries apart
+        uint64_t low = 2 * firstEntry + 1;
+        uint64_t high = 2 * (lastEntry - 1) + 1;
+        for (size_t i = 1; i < basePrimes.size(); ++i) {
+            uint64_t prime = basePrimes[i];
+            if (prime * prime > high) {
+                break;
+            }
+            uint64_t startNumber = std::max(prime * prime, (low + prime - 1) / prime * prime);
+            if (startNumber % 2 == 0) {
+                startNumber += prime;
+            }
+            for (uint64_t entry = startNumber / 2; entry < lastEntry; entry += prime) {
+                if (entries_[entry] == 0) {
+                    entries_[entry] = static_cast<uint16_t>(prime);
+                }
+            }
+        }
+    }
+
+    uint32_t limit_;
+    std::vector<uint16_t> entries_;
+};
+
+class DistributedSieve {
+public:
+    // Coordinator splits [low, high] into chunks and hands them to worker processes connected over
+    // a Unix ("unix:/path") or TCP ("tcp:host:port") socket. Local workers are forked from the same binary,
+    // workers on other hosts connect with --worker=<address>. Chunks of dead workers are retried, chunks
+    // running longer than stragglerMs get a backup copy on an idle worker and the first result wins,
+    // workers that do not answer within taskTimeoutMs are dropped and their chunk is retried.
+    struct Options {
+        uint64_t low = 0;
+        uint64_t high = 0;
+        uint64_t chunkSize = 0;
+        int localWorkers = 0;
+        int maxRetries = 3;
+        int stragglerMs = 1000;
+        int taskTimeoutMs = 60000;
+        bool outputPrimes = false;
+        std::string executable;
+        // Extra arguments for forked workers (fault injection)
+        std::vector<std::string> workerArguments;
+    };
+
+    // Chunk bookkeeping is kept for the whole run, more chunks than this are rejected
+    static constexpr uint64_t kMaxChunks = 1 << 20;
+
+    struct Summary {
+        uint64_t count = 0;
+        // Sum of primes modulo 2^64
+        uint64_t checksum = 0;
+        uint64_t lastPrime = 0;
+    };
+
+    static bool coordinate(const std::string& address, const Options& options, Summary& summary, std::ostream& primesOutput) {
+        uint64_t chunkSize = std::max<uint64_t>(options.chunkSize, 1);
+        if ((options.high - options.low) / chunkSize >= kMaxChunks) {
+            std::cerr << "Chunk size " << chunkSize << " splits the range into more than " << kMaxChunks << " chunks" << std::endl;
+            return false;
+        }
+        signal(SIGPIPE, SIG_IGN);
+        std::string listenAddress = address;
+        int listenFd = openSocket(listenAddress, true);
+        if (listenFd < 0) {
+            return false;
+        }
+
+        std::vector<Chunk> chunks;
+        for (uint64_t chunkLow = options.low; ; ) {
+            Chunk chunk;
+            chunk.low = chunkLow;
+            chunk.high = options.high - chunkLow < chunkSize ? options.high : chunkLow + chunkSize - 1;
+            chunks.push_back(chunk);
+            if (chunk.high == options.high) {
+                break;
+            }
+            chunkLow = chunk.high + 1;
+        }
+        std::deque<uint64_t> pendingChunks;
+        for (uint64_t i = 0; i < chunks.size(); ++i) {
+            pendingChunks.push_back(i);
+        }
+        uint64_t doneChunks = 0;
+        uint64_t nextOutputChunk = 0;
+        std::map<uint64_t, std::vector<uint64_t> > outputBuffer;
+
+        // Local workers that exit or are killed are replaced while there is work left. Only the ones that never
+        // delivered a result (e.g. could not connect) use up the respawn budget, so crashes after progress keep recovering.
+        // Each one gets a random token in its arguments and echoes it on connect, which ties the connection to the pid.
+        std::vector<pid_t> children;
+        std::map<uint64_t, pid_t> childTokens;
+        std::set<pid_t> productiveChildren;
+        std::mt19937_64 tokenGenerator((static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()());
+        int failedSpawnsLeft = options.localWorkers * (options.maxRetries + 1);
+        auto spawnWorker = [&]() {
+            uint64_t token = tokenGenerator() | 1;
+            std::vector<std::string> arguments = {options.executable, "0", "--worker=" + listenAddress,
+                                                  "--worker-token=" + std::to_string(token)};
+            arguments.insert(arguments.end(), options.workerArguments.begin(), options.workerArguments.end());
+            pid_t pid = fork();
+            if (pid == 0) {
+                std::vector<char*> argv;
+                for (std::string& argument : arguments) {
+                    argv.push_back(&argument[0]);
+                }
+                argv.push_back(nullptr);
+                execv(options.executable.c_str(), argv.data());
+                _exit(127);
+            }
+            if (pid > 0) {
+                children.push_back(pid);
+                childTokens[token] = pid;
+            }
+        };
+        for (int i = 0; i < options.localWorkers; ++i) {
+            spawnWorker();
+        }
+
+        std::vector<Connection> connections;
+        bool failed = false;
+        auto dropConnection = [&](size_t index) {
+            // Give the in-flight chunk back to the queue unless a backup copy is still running,
+            // a local worker behind the connection is killed and replaced once reaped
+            Connection& connection = connections[index];
+            close(connection.fd);
+            if (connection.child > 0) {
+                kill(connection.child, SIGKILL);
+            }
+            if (connection.chunk >= 0) {
+                Chunk& chunk = chunks[connection.chunk];
+                --chunk.inFlight;
+                if (!chunk.done && chunk.inFlight == 0) {
+                    if (++chunk.attempts > options.maxRetries) {
+                        std::cerr << "Chunk [" << chunk.low << ", " << chunk.high << "] failed "
+                                  << chunk.attempts << " times, giving up" << std::endl;
+                        failed = true;
+                    }
+                    pendingChunks.push_front(connection.chunk);
+                }
+            }
+            connections.erase(connections.begin() + index);
+        };
+        while (doneChunks < chunks.size() && !failed) {
+            std::vector<pollfd> pollFds = {{listenFd, POLLIN, 0}};
+            for (const Connection& connection : connections) {
+                pollFds.push_back({connection.fd, POLLIN, 0});
+            }
+            poll(pollFds.data(), pollFds.size(), 100);
+            auto now = std::chrono::steady_clock::now();
+
+            // Collect results, closed connections give their in-flight chunk back to the queue
+            for (size_t i = pollFds.size() - 1; i-- > 0; ) {
+                Connection& connection = connections[i];
+                if ((pollFds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                    continue;
+                }
+                uint8_t data[64 * 1024];
+                ssize_t bytesRead = read(connection.fd, data, sizeof(data));
+                bool valid = bytesRead > 0;
+                if (valid) {
+                    connection.buffer.insert(connection.buffer.end(), data, data + bytesRead);
+                    if (!connection.greeted && connection.buffer.size() >= kHelloSize) {
+                        auto child = childTokens.find(decode(connection.buffer.data(), 0));
+                        if (child != childTokens.end()) {
+                            connection.child = child->second;
+                            // A token identifies one connection only
+                            childTokens.erase(child);
+                        }
+                        connection.greeted = true;
+                        connection.buffer.erase(connection.buffer.begin(), connection.buffer.begin() + kHelloSize);
+                    }
+                    while (connection.greeted && connection.buffer.size() >= kResultHeaderSize) {
+                        uint64_t payloadCount = decode(connection.buffer.data(), 4);
+                        size_t messageSize = kResultHeaderSize + 8 * payloadCount;
+                        if (connection.buffer.size() < messageSize) {
+                            break;
+                        }
+                        uint64_t chunkIndex = decode(connection.buffer.data(), 0);
+                        if (chunkIndex >= chunks.size() || static_cast<int64_t>(chunkIndex) != connection.chunk) {
+                            std::cerr << "Unexpected result for chunk " << chunkIndex << ", dropping worker" << std::endl;
+                            valid = false;
+                            break;
+                        }
+                        if (connection.child > 0) {
+                            productiveChildren.insert(connection.child);
+                        }
+                        Chunk& chunk = chunks[chunkIndex];
+                        --chunk.inFlight;
+                        if (!chunk.done) {
+                            chunk.done = true;
+                            ++doneChunks;
+                            summary.count += decode(connection.buffer.data(), 1);
+                            summary.checksum += decode(connection.buffer.data(), 2);
+                            chunk.lastPrime = decode(connection.buffer.data(), 3);
+                            if (options.outputPrimes) {
+                                std::vector<uint64_t>& primeNumbers = outputBuffer[chunkIndex];
+                                for (uint64_t j = 0; j < payloadCount; ++j) {
+                                    primeNumbers.push_back(decode(connection.buffer.data() + kResultHeaderSize, j));
+                                }
+                            }
+                        }
+                        connection.buffer.erase(connection.buffer.begin(), connection.buffer.begin() + messageSize);
+                        connection.chunk = -1;
+                    }
+                }
+                if (!valid) {
+                    dropConnection(i);
+                }
+            }
+
+            // Workers stuck on a chunk longer than taskTimeoutMs are dropped
+            for (size_t i = connections.size(); i-- > 0; ) {
+                if (connections[i].chunk >= 0 && now - connections[i].started > std::chrono::milliseconds(options.taskTimeoutMs)) {
+                    std::cerr << "Worker timed out on chunk [" << chunks[connections[i].chunk].low << ", "
+                              << chunks[connections[i].chunk].high << "]" << std::endl;
+                    dropConnection(i);
+                }
+            }
+
+            if (pollFds[0].revents & POLLIN) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    Connection connection;
+                    connection.fd = fd;
+                    connections.push_back(connection);
+                }
+            }
+
+            // Stream finished chunks in order
+            while (options.outputPrimes && nextOutputChunk < chunks.size() && chunks[nextOutputChunk].done) {
+                std::string text;
+                for (uint64_t prime : outputBuffer[nextOutputChunk]) {
+                    text += std::to_string(prime) + "\n";
+                }
+                primesOutput << text;
+                outputBuffer.erase(nextOutputChunk++);
+            }
+
+            // Replace exited local workers while there is work left
+            for (size_t i = children.size(); i-- > 0; ) {
+                if (waitpid(children[i], nullptr, WNOHANG) == children[i]) {
+                    if (productiveChildren.erase(children[i]) == 0) {
+                        --failedSpawnsLeft;
+                    }
+                    // The pid may be reused from now on, so nothing must signal it any more
+                    for (Connection& connection : connections) {
+                        if (connection.child == children[i]) {
+                            connection.child = 0;
+                        }
+                    }
+                    for (auto token = childTokens.begin(); token != childTokens.end(); ) {
+                        token = token->second == children[i] ? childTokens.erase(token) : std::next(token);
+                    }
+                    children.erase(children.begin() + i);
+                    if (failedSpawnsLeft > 0) {
+                        spawnWorker();
+                    }
+                }
+            }
+            // Nothing can make progress without live connections, running local workers or respawns left
+            if (options.localWorkers > 0 && children.empty() && connections.empty()) {
+                std::cerr << "All local workers failed" << std::endl;
+                failed = true;
+            }
+
+            // Dispatch pending chunks to idle workers, then back up stragglers
+            for (Connection& connection : connections) {
+                if (!connection.greeted || connection.chunk >= 0 || failed) {
+                    continue;
+                }
+                int64_t chunkIndex = -1;
+                if (!pendingChunks.empty()) {
+                    chunkIndex = static_cast<int64_t>(pendingChunks.front());
+                    pendingChunks.pop_front();
+                } else {
+                    auto oldest = now;
+                    for (size_t j = 0; j < chunks.size(); ++j) {
+                        if (!chunks[j].done && chunks[j].inFlight == 1 && chunks[j].started < oldest
+                            && now - chunks[j].started > std::chrono::milliseconds(options.stragglerMs)) {
+                            oldest = chunks[j].started;
+                            chunkIndex = static_cast<int64_t>(j);
+                        }
+                    }
+                }
+                if (chunkIndex < 0) {
+                    continue;
+                }
+                Chunk& chunk = chunks[chunkIndex];
+                uint8_t task[kTaskSize];
+                encode(task, 0, static_cast<uint64_t>(chunkIndex));
+                encode(task, 1, chunk.low);
+                encode(task, 2, chunk.high);
+                encode(task, 3, options.outputPrimes ? 1 : 0);
+                if (chunk.inFlight == 0) {
+                    chunk.started = now;
+                }
+                ++chunk.inFlight;
+                connection.chunk = chunkIndex;
+                connection.started = now;
+                // A failed write shows up as a closed connection on the next poll
+                writeAll(connection.fd, task, kTaskSize);
+            }
+        }
+
+        // Shut workers down, kill the ones stuck on abandoned chunks
+        uint8_t shutdown[kTaskSize];
+        encode(shutdown, 0, kShutdown);
+        for (const Connection& connection : connections) {
+            writeAll(connection.fd, shutdown, kTaskSize);
+            close(connection.fd);
+        }
+        close(listenFd);
+        if (listenAddress.rfind("unix:", 0) == 0) {
+            unlink(listenAddress.substr(5).c_str());
+        }
+        auto shutdownStart = std::chrono::steady_clock::now();
+        while (!children.empty()) {
+            for (size_t i = children.size(); i-- > 0; ) {
+                if (waitpid(children[i], nullptr, WNOHANG) == children[i]) {
+                    children.erase(children.begin() + i);
+                } else if (std::chrono::steady_clock::now() - shutdownStart > std::chrono::seconds(1)) {
+                    kill(children[i], SIGKILL);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        for (const Chunk& chunk : chunks) {
+            if (chunk.lastPrime != 0) {
+                summary.lastPrime = chunk.lastPrime;
+            }
+        }
+        return !failed;
+    }
+
+    static int work(const std::string& address, uint64_t token, int crashAfter, int stallAfter) {
+        // Serve chunks until shutdown; token is the one a coordinator gave its forked worker (0 otherwise),
+        // crashAfter/stallAfter make the worker exit or hang on that task (fault injection)
+        signal(SIGPIPE, SIG_IGN);
+        std::string connectAddress = address;
+        int fd = -1;
+        for (int attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+            fd = openSocket(connectAddress, false);
+            if (fd < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+        uint8_t hello[kHelloSize];
+        encode(hello, 0, token);
+        if (fd < 0 || !writeAll(fd, hello, kHelloSize)) {
+            return 1;
+        }
+
+        std::vector<uint32_t> basePrimes;
+        uint64_t basePrimesLimit = 0;
+        std::vector<uint64_t> words;
+        for (int tasks = 1; ; ++tasks) {
+            uint8_t task[kTaskSize];
+            if (!readAll(fd, task, kTaskSize) || decode(task, 0) == kShutdown) {
+                break;
+            }
+            if (tasks == crashAfter) {
+                _exit(3);
+            }
+            if (tasks == stallAfter) {
+                std::this_thread::sleep_for(std::chrono::hours(1));
+            }
+            uint64_t low = decode(task, 1);
+            uint64_t high = decode(task, 2);
+            bool outputPrimes = decode(task, 3) != 0;
+
+            std::vector<uint64_t> primeNumbers;
+            uint64_t count = 0;
+            uint64_t checksum = 0;
+            uint64_t lastPrime = 0;
+            auto addPrime = [&](uint64_t prime) {
+                ++count;
+                checksum += prime;
+                lastPrime = prime;
+                if (outputPrimes) {
+                    primeNumbers.push_back(prime);
+                }
+            };
+            if (low <= 2 && high >= 2) {
+                addPrime(2);
+            }
+            uint64_t firstOdd = std::max<uint64_t>(low, 3) | 1;
+            if (firstOdd <= high) {
+                if (basePrimesLimit < SegmentSieve::isqrt(high)) {
+                    basePrimesLimit = SegmentSieve::isqrt(high);
+                    basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(basePrimesLimit));
+                }
+                uint64_t oddNumbersCount = (high - firstOdd) / 2 + 1;
+                for (uint64_t bit = 0; bit < oddNumbersCount; bit += SegmentSieve::segmentBits()) {
+                    SegmentSieve::sieve(firstOdd + 2 * bit, std::min(SegmentSieve::segmentBits(), oddNumbersCount - bit), basePrimes, words);
+                    SegmentSieve::forEachPrime(firstOdd + 2 * bit, words, addPrime);
+                }
+            }
+
+            std::vector<uint8_t> result(kResultHeaderSize + 8 * primeNumbers.size());
+            encode(result.data(), 0, decode(task, 0));
+            encode(result.data(), 1, count);
+            encode(result.data(), 2, checksum);
+            encode(result.data(), 3, lastPrime);
+            encode(result.data(), 4, primeNumbers.size());
+            for (size_t i = 0; i < primeNumbers.size(); ++i) {
+                encode(result.data() + kResultHeaderSize, i, primeNumbers[i]);
+            }
+            if (!writeAll(fd, result.data(), result.size())) {
+                break;
+            }
+        }
+        close(fd);
+        return 0;
+    }
+private:
+    // Messages are little-endian uint64 fields so hosts of any byte order can mix.
+    // Hello: worker token (0 for workers not forked by the coordinator), sent once on connect.
+    // Task: chunk index (kShutdown stops the worker), low, high, flags (1 = send primes).
+    // Result: chunk index, count, checksum, last prime, primes count, then the primes if requested.
+    static constexpr size_t kHelloSize = 8;
+    static constexpr size_t kTaskSize = 4 * 8;
+    static constexpr size_t kResultHeaderSize = 5 * 8;
+    static constexpr uint64_t kShutdown = UINT64_MAX;
+
+    struct Chunk {
+        uint64_t low = 0;
+        uint64_t high = 0;
+        bool done = false;
+        int attempts = 0;
+        int inFlight = 0;
+        uint64_t lastPrime = 0;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    struct Connection {
+        int fd = -1;
+        bool greeted = false;
+        // Local worker matched by its hello token, 0 for remote workers
+        pid_t child = 0;
+        std::vector<uint8_t> buffer;
+        int64_t chunk = -1;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    static void encode(uint8_t* data, size_t field, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            data[8 * field + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    static uint64_t decode(const uint8_t* data, size_t field) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(data[8 * field + i]) << (8 * i);
+        }
+        return value;
+    }
+
+    static bool writeAll(int fd, const uint8_t* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd, data, size);
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    static bool readAll(int fd, uint8_t* data, size_t size) {
+        while (size > 0) {
+            ssize_t bytesRead = read(fd, data, size);
+            if (bytesRead <= 0) {
+                return false;
+            }
+            data += bytesRead;
+            size -= bytesRead;
+        }
+        return true;
+    }
+
+    static int openSocket(std::string& address, bool listening) {
+        // Listen on or connect to "unix:/path" or "tcp:host:port". Listening on TCP port 0
+        // picks a free port, written back to address so forked workers can connect.
+        int fd = -1;
+        if (address.rfind("unix:", 0) == 0) {
+            sockaddr_un socketAddress = {};
+            socketAddress.sun_family = AF_UNIX;
+            std::string path = address.substr(5);
+            if (path.size() >= sizeof(socketAddress.sun_path)) {
+                std::cerr << "Unix socket path is too long: " << path << std::endl;
+                return -1;
+            }
+            std::strncpy(socketAddress.sun_path, path.c_str(), sizeof(socketAddress.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listening) {
+                unlink(path.c_str());
+            }
+            if (fd >= 0 && (listening ? bind(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) == 0 && listen(fd, 64) == 0
+                                      : connect(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) == 0)) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                return fd;
+            }
+        } else if (address.rfind("tcp:", 0) == 0 && address.rfind(':') > 3) {
+            size_t portSeparator = address.rfind(':');
+            std::string host = address.substr(4, portSeparator - 4);
+            std::string port = address.substr(portSeparator + 1);
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = listening ? AI_PASSIVE : 0;
+            addrinfo* addresses = nullptr;
+            if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) == 0) {
+                for (addrinfo* info = addresses; info != nullptr && fd < 0; info = info->ai_next) {
+                    fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+                    int enable = 1;
+                    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+                    if (fd >= 0 && !(listening ? bind(fd, info->ai_addr, info->ai_addrlen) == 0 && listen(fd, 64) == 0
+                                               : connect(fd, info->ai_addr, info->ai_addrlen) == 0)) {
+                        close(fd);
+                        fd = -1;
+                    }
+                }
+                freeaddrinfo(addresses);
+            }
+            if (fd >= 0) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                if (listening && port == "0") {
+                    sockaddr_storage boundAddress = {};
+                    socklen_t length = sizeof(boundAddress);
+                    getsockname(fd, reinterpret_cast<sockaddr*>(&boundAddress), &length);
+                    char boundPort[16];
+                    getnameinfo(reinterpret_cast<sockaddr*>(&boundAddress), length, nullptr, 0, boundPort, sizeof(boundPort), NI_NUMERICSERV);
+                    address = "tcp:" + (host.empty() ? std::string("127.0.0.1") : host) + ":" + boundPort;
+                }
+                return fd;
+            }
+            return -1;
+        } else {
+            std::cerr << "Unsupported address (expected unix:/path or tcp:host:port): " << address << std::endl;
+            return -1;
+        }
+        if (listening) {
+            std::cerr << "Cannot listen on " << address << ": " << std::strerror(errno) << std::endl;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+};
+
+class CompressedSieveStore {
+public:
+    // Persisted sieve of [low, high] split into blocks of kBlockNumbers numbers. A block is wheel-packed
+    // (one byte per 30 numbers, one bit per residue coprime to 30) and stored either raw or as Rice-coded
+    // gaps between set bits, whichever is smaller. The block index at the end of the file gives random access.
+    //
+    // File layout (little-endian uint64 fields): header {magic, version, low, high, blocksCount, indexOffset},
+    // blocks, index {offset, codec << 32 | size} per block. Blocks start at low rounded down to a multiple of 30.
+    static constexpr uint64_t kBlockNumbers = 30 * 64 * 1024;
+
+    struct Stats {
+        uint64_t blocksCount = 0;
+        uint64_t fileBytes = 0;
+        uint64_t wheelBytes = 0;
+    };
+
+    static bool write(const std::string& path, uint64_t low, uint64_t high, Stats& stats) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file || low > high) {
+            return false;
+        }
+        uint64_t base = low - low % 30;
+        uint64_t blocksCount = (high - base) / kBlockNumbers + 1;
+        std::vector<uint32_t> basePrimes = SegmentSieve::basePrimes(static_cast<uint32_t>(SegmentSieve::isqrt(high)));
+        std::vector<uint8_t> header(kHeaderFields * 8);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+        // Blocks are sieved and compressed in parallel batches, then written in order
+        int num_threads = PrimeCalculator::calculateThreadsNumber(static_cast<int>(std::min<uint64_t>(blocksCount, INT_MAX)));
+        std::vector<std::vector<uint8_t> > encodedBlocks(num_threads);
+        std::vector<uint8_t> codecs(num_threads);
+        std::vector<uint8_t> index(blocksCount * 2 * 8);
+        uint64_t offset = header.size();
+        for (uint64_t batchStart = 0; batchStart < blocksCount; batchStart += num_threads) {
+            std::vector<std::thread> threads;
+            for (int i = 0; i < num_threads && batchStart + i < blocksCount; ++i) {
+                threads.emplace_back([&, i]() {
+                    uint64_t blockLow = base + (batchStart + i) * kBlockNumbers;
+                    uint64_t blockHigh = high - blockLow < kBlockNumbers ? high : blockLow + kBlockNumbers - 1;
+                    std::vector<uint8_t> wheel = sieveWheel(std::max(blockLow, low), blockHigh, blockLow, basePrimes);
+                    codecs[i] = encode(wheel, encodedBlocks[i]);
+                });
+            }
+            // Wait for threads to finish
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            for (size_t i = 0; i < threads.size(); ++i) {
+                file.write(reinterpret_cast<const char*>(encodedBlocks[i].data()), encodedBlocks[i].size());
+                encodeField(index.data(), 2 * (batchStart + i), offset);
+                encodeField(index.data(), 2 * (batchStart + i) + 1, static_cast<uint64_t>(codecs[i]) << 32 | encodedBlocks[i].size());
+                offset += encodedBlocks[i].size();
+            }
+        }
+        file.write(reinterpret_cast<const char*>(index.data()), index.size());
+
+        uint64_t fields[kHeaderFields] = {kMagic, kVersion, low, high, blocksCount, offset};
+        for (size_t i = 0; i < kHeaderFields; ++i) {
+            encodeField(header.data(), i, fields[i]);
+        }
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+        stats.blocksCount = blocksCount;
+        stats.fileBytes = offset + index.size();
+        stats.wheelBytes = blocksCount * (kBlockNumbers / 30);
+        return static_cast<bool>(file);
+    }
+
+    class Reader {
+    public:
+        explicit Reader(const std::string& path) : file_(path, std::ios::binary) {
+            std::vector<uint8_t> header(kHeaderFields * 8);
+            if (!file_.read(reinterpret_cast<char*>(header.data()), header.size())
+                || decodeField(header.data(), 0) != kMagic || decodeField(header.data(), 1) != kVersion) {
+                return;
+            }
+            low_ = decodeField(header.data(), 2);
+            high_ = decodeField(header.data(), 3);
+            uint64_t blocksCount = decodeField(header.data(), 4);
+            indexOffset_ = decodeField(header.data(), 5);
+            // The index must close the file and cover exactly the blocks of [low, high]
+            file_.seekg(0, std::ios::end);
+            uint64_t fileBytes = static_cast<uint64_t>(file_.tellg());
+            if (low_ > high_ || blocksCount != (high_ - (low_ - low_ % 30)) / kBlockNumbers + 1
+                || indexOffset_ < header.size() || indexOffset_ > fileBytes || (fileBytes - indexOffset_) / 16 != blocksCount
+                || (fileBytes - indexOffset_) % 16 != 0) {
+                return;
+            }
+            index_.resize(blocksCount * 2 * 8);
+            file_.seekg(static_cast<std::streamoff>(indexOffset_));
+            valid_ = static_cast<bool>(file_.read(reinterpret_cast<char*>(index_.data()), index_.size()));
+        }
+
+        bool valid() const {
+            return valid_;
+        }
+
+        uint64_t low() const {
+            return low_;
+        }
+
+        uint64_t high() const {
+            return high_;
+        }
+
+        bool load(uint64_t startSegment, uint64_t endSegment, std::vector<bool>& isPrime) {
+            // Fill isPrime[n - startSegment] for n in [startSegment, endSegment] (the layout segmentSieving uses),
+            // reading and decompressing only the blocks overlapping the range
+            if (!valid_ || startSegment > endSegment || startSegment < low_ || endSegment > high_) {
+                return false;
+            }
+            isPrime.assign(endSegment - startSegment + 1, false);
+            return forEachWheelByte(startSegment, endSegment, [&](uint64_t byteLow, uint8_t bits) {
+                for (; bits != 0; bits &= bits - 1) {
+                    uint64_t number = byteLow + kWheelResidues[__builtin_ctz(bits)];
+                    if (number >= startSegment && number <= endSegment) {
+                        isPrime[number - startSegment] = true;
+                    }
+                }
+            }, [&](uint64_t prime) {
+                isPrime[prime - startSegment] = true;
+            });
+        }
+
+        bool count(uint64_t low, uint64_t high, uint64_t& primesCount) {
+            // Number of primes in [low, high], wheel bytes fully inside the range are counted with popcount
+            if (!valid_ || low > high || low < low_ || high > high_) {
+                return false;
+            }
+            primesCount = 0;
+            return forEachWheelByte(low, high, [&](uint64_t byteLow, uint8_t bits) {
+                if (byteLow >= low && byteLow <= high && high - byteLow >= 29) {
+                    primesCount += __builtin_popcount(bits);
+                    return;
+                }
+                for (; bits != 0; bits &= bits - 1) {
+                    uint64_t number = byteLow + kWheelResidues[__builtin_ctz(bits)];
+                    primesCount += number >= low && number <= high;
+                }
+            }, [&](uint64_t) {
+                ++primesCount;
+            });
+        }
+    private:
+        template <typename ByteCallback, typename SmallPrimeCallback>
+        bool forEachWheelByte(uint64_t low, uint64_t high, ByteCallback byteCallback, SmallPrimeCallback smallPrimeCallback) {
+            // Decompress the blocks overlapping [low, high] and pass every wheel byte with the number it starts at,
+            // primes 2, 3 and 5 (not on the wheel) of the range are reported separately
+            for (uint64_t prime : {2, 3, 5}) {
+                if (prime >= low && prime <= high) {
+                    smallPrimeCallback(prime);
+                }
+            }
+            uint64_t base = low_ - low_ % 30;
+            std::vector<uint8_t> encoded;
+            std::vector<uint8_t> wheel;
+            for (uint64_t block = (low - base) / kBlockNumbers; block <= (high - base) / kBlockNumbers; ++block) {
+                // Blocks lie between the header and the index and are never larger than the raw wheel bytes
+                uint64_t offset = decodeField(index_.data(), 2 * block);
+                uint64_t location = decodeField(index_.data(), 2 * block + 1);
+                uint64_t size = location & 0xFFFFFFFFULL;
+                if (offset < kHeaderFields * 8 || offset > indexOffset_ || size > indexOffset_ - offset || size > kBlockNumbers / 30) {
+                    return false;
+                }
+                encoded.resize(size);
+                file_.seekg(static_cast<std::streamoff>(offset));
+                if (!file_.read(reinterpret_cast<char*>(encoded.data()), encoded.size())
+                    || !decode(static_cast<uint8_t>(location >> 32), encoded, wheel)) {
+                    return false;
+                }
+
+                uint64_t blockLow = base + block * kBlockNumbers;
+                for (size_t byte = 0; byte < wheel.size(); ++byte) {
+                    if (wheel[byte] != 0) {
+                        byteCallback(blockLow + 30 * byte, wheel[byte]);
+                    }
+                }
+            }
+            return true;
+        }
+
+        std::ifstream file_;
+        std::vector<uint8_t> index_;
+        uint64_t indexOffset_ = 0;
+        uint64_t low_ = 0;
+        uint64_t high_ = 0;
+        bool valid_ = false;
+    };
+private:
+    static constexpr uint64_t kMagic = 0x474553454D495250ULL;  // "PRIMESEG"
+    static constexpr uint64_t kVersion = 1;
+    static constexpr size_t kHeaderFields = 6;
+    static constexpr uint8_t kCodecRaw = 0;
+    static constexpr uint8_t kCodecRice = 1;
+    static constexpr uint8_t kWheelResidues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+    static void encodeField(uint8_t* data, size_t field, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            data[8 * field + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    static uint64_t decodeField(const uint8_t* data, size_t field) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(data[8 * field + i]) << (8 * i);
+        }
+        return value;
+    }
+
+    static std::vector<uint8_t> sieveWheel(uint64_t low, uint64_t high, uint64_t blockLow, const std::vector<uint32_t>& basePrimes) {
+        // Wheel bytes of the block starting at blockLow with primes of [low, high] above 5
+        static const int8_t residueBits[30] = {-1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1,
+                                               -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7};
+        std::vector<uint8_t> wheel(kBlockNumbers / 30, 0);
+        uint64_t firstOdd = std::max<uint64_t>(low, 7) | 1;
+        if (firstOdd > high) {
+            return wheel;
+        }
+        uint64_t oddNumbersCount = (high - firstOdd) / 2 + 1;
+        std::vector<uint64_t> words;
+        for (uint64_t bit = 0; bit < oddNumbersCount; bit += SegmentSieve::segmentBits()) {
+            SegmentSieve::sieve(firstOdd + 2 * bit, std::min(SegmentSieve::segmentBits(), oddNumbersCount - bit), basePrimes, words);
+            SegmentSieve::forEachPrime(firstOdd + 2 * bit, words, [&wheel, blockLow](uint64_t prime) {
+                uint64_t offset = prime - blockLow;
+                wheel[offset / 30] |= static_cast<uint8_t>(1 << residueBits[offset % 30]);
+            });
+        }
+        return wheel;
+    }
+
+    static uint8_t encode(const std::vector<uint8_t>& wheel, std::vector<uint8_t>& encoded) {
+        // Rice code of gaps between set bits: {uint32 set bits count, uint8 parameter k, bit stream}.
+        // k = floor(log2(mean gap)) is close to optimal for geometrically distributed gaps.
+        uint64_t bitsCount = 0;
+        for (uint8_t byte : wheel) {
+            bitsCount += __builtin_popcount(byte);
+        }
+        uint64_t meanGap = bitsCount == 0 ? 1 : std::max<uint64_t>(1, wheel.size() * 8 / bitsCount);
+        int k = 63 - __builtin_clzll(meanGap);
+
+        encoded.assign(5, 0);
+        for (int i = 0; i < 4; ++i) {
+            encoded[i] = static_cast<uint8_t>(bitsCount >> (8 * i));
+        }
+        encoded[4] = static_cast<uint8_t>(k);
+        // Bits are collected LSB first in a 64-bit accumulator and flushed 32 at a time
+        uint64_t accumulator = 0;
+        int accumulatorBits = 0;
+        auto putBits = [&](uint64_t value, int count) {
+            // count <= 32
+            accumulator |= value << accumulatorBits;
+            accumulatorBits += count;
+            if (accumulatorBits >= 32) {
+                for (int i = 0; i < 4; ++i) {
+                    encoded.push_back(static_cast<uint8_t>(accumulator >> (8 * i)));
+                }
+                accumulator >>= 32;
+                accumulatorBits -= 32;
+            }
+        };
+
+        uint64_t previous = 0;
+        for (size_t byte = 0; byte < wheel.size() && encoded.size() < wheel.size(); ++byte) {
+            for (uint8_t bits = wheel[byte]; bits != 0; bits &= bits - 1) {
+                uint64_t position = byte * 8 + __builtin_ctz(bits) + 1;
+                uint64_t gap = position - previous - 1;
+                previous = position;
+                // Unary quotient (ones ended by a zero), then the k low bits of the gap
+                uint64_t quotient = gap >> k;
+                for (; quotient >= 32; quotient -= 32) {
+                    putBits(0xFFFFFFFFULL, 32);
+                }
+                putBits((1ULL << quotient) - 1, static_cast<int>(quotient) + 1);
+                putBits(gap & ((1ULL << k) - 1), k);
+            }
+        }
+        for (; accumulatorBits > 0; accumulatorBits -= 8) {
+            encoded.push_back(static_cast<uint8_t>(accumulator));
+            accumulator >>= 8;
+        }
+        if (encoded.size() >= wheel.size()) {
+            encoded = wheel;
+            return kCodecRaw;
+        }
+        return kCodecRice;
+    }
+
+    static bool decode(uint8_t codec, const std::vector<uint8_t>& encoded, std::vector<uint8_t>& wheel) {
+        // False for a block that does not decode to exactly one block of wheel bytes
+        if (codec == kCodecRaw) {
+            wheel = encoded;
+            return wheel.size() == kBlockNumbers / 30;
+        }
+        if (codec != kCodecRice || encoded.size() < 5) {
+            return false;
+        }
+        wheel.assign(kBlockNumbers / 30, 0);
+        uint64_t bitsCount = 0;
+        for (int i = 0; i < 4; ++i) {
+            bitsCount |= static_cast<uint64_t>(encoded[i]) << (8 * i);
+        }
+        int k = encoded[4];
+        if (bitsCount > wheel.size() * 8 || k > 32) {
+            return false;
+        }
+
+        // Bit buffer refilled a byte at a time to hold at least 57 bits while input remains
+        uint64_t buffer = 0;
+        int bufferBits = 0;
+        size_t bytePosition = 5;
+        auto refill = [&]() {
+            for (; bufferBits <= 56 && bytePosition < encoded.size(); bufferBits += 8) {
+                buffer |= static_cast<uint64_t>(encoded[bytePosition++]) << bufferBits;
+            }
+        };
+
+        uint64_t previous = 0;
+        for (uint64_t i = 0; i < bitsCount; ++i) {
+            uint64_t quotient = 0;
+            while (true) {
+                refill();
+                if (bufferBits == 0) {
+                    return false;
+                }
+                int ones = ~buffer == 0 ? 64 : __builtin_ctzll(~buffer);
+                if (ones < bufferBits) {
+                    quotient += ones;
+                    buffer >>= ones;
+                    buffer >>= 1;
+                    bufferBits -= ones + 1;
+                    break;
+                }
+                quotient += bufferBits;
+                buffer = 0;
+                bufferBits = 0;
+            }
+            refill();
+            if (bufferBits < k || quotient > wheel.size() * 8) {
+                return false;
+            }
+            uint64_t gap = quotient << k | (buffer & ((1ULL << k) - 1));
+            buffer >>= k;
+            bufferBits -= k;
+            uint64_t position = previous + gap + 1;
+            if (position > wheel.size() * 8) {
+                return false;
+            }
+            previous = position;
+            wheel[(position - 1) / 8] |= static_cast<uint8_t>(1 << ((position - 1) % 8));
+        }
+        return true;
+    }
+};
+
+class BoundedMemorySieve {
+public:
+    // Sieve up to maxPrime within a hard memory budget: plans segment size, concurrency and result storage,
+    // runs the pipelined sieve (in-flight memory bounded by ring depth) and keeps the result in memory
+    // when it fits, otherwise streams it into an unlinked temporary file.
+    struct Plan {
+        int threads = 1;
+        size_t ringDepth = 1;
+        uint64_t segmentBytes = 0;
+        // Upper bound of the result size, Dusart: pi(x) < 1.25506 * x / ln(x)
+        uint64_t resultBytes = 0;
+        bool spill = false;
+        uint64_t spillBufferBytes = 0;
+    };
+
+    class Result {
+    public:
+        Result() = default;
+        Result(const Result&) = delete;
+        Result& operator=(const Result&) = delete;
+
+        ~Result() {
+            if (spillFd_ >= 0) {
+                close(spillFd_);
+            }
+        }
+
+        uint64_t size() const {
+            return count_;
+        }
+
+        bool back(uint32_t& prime) const {
+            // Largest prime of a non-empty result, false when the spill file cannot be read back
+            if (spillFd_ < 0) {
+                prime = primeNumbers_.back();
+                return true;
+            }
+            if (pread(spillFd_, &prime, sizeof(prime), static_cast<off_t>((count_ - 1) * sizeof(prime))) != sizeof(prime)) {
+                std::cerr << "Cannot read spill file: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            return true;
+        }
+    private:
+        friend class BoundedMemorySieve;
+        std::vector<uint32_t> primeNumbers_;
+        int spillFd_ = -1;
+        uint64_t count_ = 0;
+    };
+
+    static bool plan(uint64_t maxPrime, uint64_t maxMemory, Plan& plan) {
+        // Budget is split into process baseline, base primes, sieve ring and either the whole result or a spill buffer
+        const AutoTuner::Settings& settings = AutoTuner::settings();
+        uint64_t sqrtMaxPrime = SegmentSieve::isqrt(maxPrime);
+        uint64_t fixedBytes = kBaselineBytes + sqrtMaxPrime / 8 + estimatePrimesCount(sqrtMaxPrime) * sizeof(uint32_t);
+        if (maxMemory <= fixedBytes) {
+            return false;
+        }
+        uint64_t available = maxMemory - fixedBytes;
+
+        plan.threads = settings.threads;
+        plan.segmentBytes = settings.segmentBytes;
+        plan.ringDepth = 4 * static_cast<size_t>(plan.threads);
+        plan.resultBytes = estimatePrimesCount(maxPrime) * sizeof(uint32_t);
+        plan.spill = plan.resultBytes + plan.ringDepth * plan.segmentBytes > available;
+        if (!plan.spill) {
+            return true;
+        }
+
+        plan.spillBufferBytes = std::min<uint64_t>(std::max<uint64_t>(available / 4, 64 * 1024), 4 << 20);
+        if (plan.spillBufferBytes >= available) {
+            return false;
+        }
+        uint64_t ringBytes = available - plan.spillBufferBytes;
+        if (ringBytes < 2 * plan.segmentBytes) {
+            // Two smaller segments still let one be sieved while the other is drained
+            plan.segmentBytes = ringBytes / 2 / 8 * 8;
+            if (plan.segmentBytes < kMinSegmentBytes) {
+                return false;
+            }
+        }
+        plan.ringDepth = std::min<uint64_t>(plan.ringDepth, ringBytes / plan.segmentBytes);
+        plan.threads = std::max(1, std::min(plan.threads, static_cast<int>(plan.ringDepth) - 1));
+        return true;
+    }
+
+    static bool run(uint64_t maxPrime, const Plan& plan, const std::string& spillDirectory, Result& result) {
+        // maxPrime must stay below 2^32 (primes are stored as uint32_t)
+        if (!plan.spill) {
+            result.primeNumbers_.reserve(plan.resultBytes / sizeof(uint32_t));
+            PipelinedSieve::run(maxPrime, [&result](uint64_t prime) {
+                result.primeNumbers_.push_back(static_cast<uint32_t>(prime));
+            }, plan.threads, plan.ringDepth, plan.segmentBytes * 8);
+            result.count_ = result.primeNumbers_.size();
+            return true;
+        }
+
+        std::string path = spillDirectory + "/PerformanceInvestigationCpp-XXXXXX";
+        result.spillFd_ = mkstemp(&path[0]);
+        if (result.spillFd_ < 0) {
+            std::cerr << "Cannot create spill file in " << spillDirectory << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // File disappears with the descriptor
+        unlink(path.c_str());
+
+        std::vector<uint32_t> buffer;
+        buffer.reserve(plan.spillBufferBytes / sizeof(uint32_t));
+        bool written = true;
+        auto flush = [&]() {
+            const char* data = reinterpret_cast<const char*>(buffer.data());
+            size_t size = buffer.size() * sizeof(uint32_t);
+            while (written && size > 0) {
+                ssize_t bytesWritten = write(result.spillFd_, data, size);
+                written = bytesWritten > 0;
+                data += std::max<ssize_t>(bytesWritten, 0);
+                size -= std::max<ssize_t>(bytesWritten, 0);
+            }
+            buffer.clear();
+        };
+        PipelinedSieve::run(maxPrime, [&](uint64_t prime) {
+            buffer.push_back(static_cast<uint32_t>(prime));
+            if (buffer.size() == buffer.capacity()) {
+                flush();
+            }
+            ++result.count_;
+        }, plan.threads, plan.ringDepth, plan.segmentBytes * 8);
+        flush();
+        if (!written) {
+            std::cerr << "Cannot write spill file: " << std::strerror(errno) << std::endl;
+        }
+        return written;
+    }
+
+    static uint64_t parseBytes(const std::string& size) {
+        // Number of bytes with an optional K, M or G suffix
+        uint64_t value = std::stoull(size);
+        switch (size.empty() ? ' ' : std::toupper(static_cast<unsigned char>(size.back()))) {
+            case 'K': return value << 10;
+            case 'M': return value << 20;
+            case 'G': return value << 30;
+            default: return value;
+        }
+    }
+private:
+    // Resident memory of the process before sieving (code, libc, stacks)
+    static constexpr uint64_t kBaselineBytes = 8 << 20;
+    static constexpr uint64_t kMinSegmentBytes = 4 * 1024;
+
+    static uint64_t estimatePrimesCount(uint64_t number) {
+        if (number < 17) {
+            return 6;
+        }
+        return static_cast<uint64_t>(1.25506 * static_cast<double>(number) / std::log(static_cast<double>(number))) + 1;
+    }
+};
+
+static std::string toString(unsigned __int128 value) {
+    std::string digits;
+    do {
+        digits.insert(digits.begin(), static_cast<char>('0' + static_cast<int>(value % 10)));
+        value /= 10;
+    } while (value != 0);
+    return digits;
+}
+
+static std::map<std::string, std::string> parseOptions(int argc, char **argv) {
+    // Options after maxPrime: --name or --name=value
+    std::map<std::string, std::string> options;
+    for (int i = 2; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument.rfind("--", 0) != 0) {
+            continue;
+        }
+        size_t separator = argument.find('=');
+        if (separator == std::string::npos) {
+            options[argument.substr(2)] = "";
+        } else {
+            options[argument.substr(2, separator - 2)] = argument.substr(separator + 1);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char **argv) {
+    std::map<std::string, std::string> options = parseOptions(argc, argv);
+
+    // --tune: calibrate thread count and segment size for this host and cache the result for later runs
+    if (options.count("tune")) {
+        AutoTuner::calibrate();
+    }
+    if (options.count("tune") || options.count("tuning")) {
+        const AutoTuner::Settings& settings = AutoTuner::settings();
+        std::cout << "cpus: " << settings.availableCpus << " allowed, " << settings.physicalCores << " physical cores, quota "
+                  << (settings.quotaCpus == 0 ? std::string("unlimited") : std::to_string(settings.quotaCpus)) << std::endl;
+        std::cout << "caches: L1d " << settings.l1DataBytes << " bytes, L2 " << settings.l2Bytes << " bytes" << std::endl;
+        std::cout << "threads: " << settings.threads << ", segment: " << settings.segmentBytes << " bytes, atkin segment: "
+                  << settings.atkinSegmentBytes << " bytes" << (settings.tuned ? " (tuned)" : " (detected)") << std::endl;
+        return 0;
+    }
+
+    // --worker=<address>: serve chunks of a coordinator (the argument is ignored)
+    if (options.count("worker")) {
+        int crashAfter = options.count("crash-after") ? std::stoi(options["crash-after"]) : 0;
+        int stallAfter = options.count("stall-after") ? std::stoi(options["stall-after"]) : 0;
+        uint64_t token = options.count("worker-token") ? std::stoull(options["worker-token"]) : 0;
+        return DistributedSieve::work(options["worker"], token, crashAfter, stallAfter);
+    }
+
+    // --coordinator=<address> [--from=low] [--workers=n] [--chunk=size] [--retries=n] [--straggler-ms=ms]
+    // [--task-timeout-ms=ms] [--primes]:
+    // sieve [low, maxPrime] on worker processes, print count, checksum and last prime, or all primes in order with --primes.
+    // --crash-after=k / --stall-after=k are passed to forked workers to inject faults.
+    if (options.count("coordinator")) {
+        DistributedSieve::Options distributedOptions;
+        distributedOptions.low = options.count("from") ? std::stoull(options["from"]) : 0;
+        distributedOptions.high = std::stoull(argv[1]);
+        distributedOptions.localWorkers = options.count("workers") ? std::stoi(options["workers"])
+                                                                   : AutoTuner::settings().threads;
+        // About 16 chunks per local worker, without wrapping for the full 64-bit range
+        uint64_t span = distributedOptions.high - std::min(distributedOptions.low, distributedOptions.high);
+        distributedOptions.chunkSize = options.count("chunk") ? std::stoull(options["chunk"])
+                                                              : std::max({uint64_t(1) << 20, span / (16 * std::max(1, distributedOptions.localWorkers)) + 1,
+                                                                          span / DistributedSieve::kMaxChunks + 1});
+        if (options.count("retries")) {
+            distributedOptions.maxRetries = std::stoi(options["retries"]);
+        }
+        if (options.count("straggler-ms")) {
+            distributedOptions.stragglerMs = std::stoi(options["straggler-ms"]);
+        }
+        if (options.count("task-timeout-ms")) {
+            distributedOptions.taskTimeoutMs = std::stoi(options["task-timeout-ms"]);
+        }
+        distributedOptions.outputPrimes = options.count("primes") != 0;
+        distributedOptions.executable = argv[0];
+        for (const char* faultOption : {"crash-after", "stall-after"}) {
+            if (options.count(faultOption)) {
+                distributedOptions.workerArguments.push_back(std::string("--") + faultOption + "=" + options[faultOption]);
+            }
+        }
+        if (distributedOptions.low > distributedOptions.high) {
+            return 0;
+        }
+        DistributedSieve::Summary summary;
+        if (!DistributedSieve::coordinate(options["coordinator"], distributedOptions, summary, std::cout)) {
+            return 1;
+        }
+        if (!distributedOptions.outputPrimes) {
+            std::cout << "count: " << summary.count << std::endl;
+            std::cout << "checksum: " << summary.checksum << std::endl;
+            std::cout << "last: " << summary.lastPrime << std::endl;
+        }
+        return 0;
+    }
+
+    // --store-write=<file>: sieve [from, maxPrime] into a compressed block store,
+    // --store-read=<file>: count primes of [from, maxPrime] from a store, paging in only the blocks needed
+    if (options.count("store-write")) {
+        uint64_t low = options.count("from") ? std::stoull(options["from"]) : 0;
+        CompressedSieveStore::Stats stats;
+        if (!CompressedSieveStore::write(options["store-write"], low, std::stoull(argv[1]), stats)) {
+            std::cerr << "Cannot write " << options["store-write"] << std::endl;
+            return 1;
+        }
+        std::cout << "blocks: " << stats.blocksCount << ", file: " << stats.fileBytes << " bytes, wheel bitmap: "
+                  << stats.wheelBytes << " bytes" << std::endl;
+        return 0;
+    }
+    if (options.count("store-read")) {
+        CompressedSieveStore::Reader reader(options["store-read"]);
+        uint64_t low = options.count("from") ? std::stoull(options["from"]) : reader.low();
+        uint64_t primesCount = 0;
+        if (!reader.count(low, std::stoull(argv[1]), primesCount)) {
+            std::cerr << "Cannot read the range from " << options["store-read"] << " (stored range is ["
+                      << reader.low() << ", " << reader.high() << "])" << std::endl;
+            return 1;
+        }
+        std::cout << primesCount << std::endl;
+        return 0;
+    }
+
+    // --max-memory=<bytes[K|M|G]>: same output as the default mode within the memory budget,
+    // the result spills to a temporary file in --spill-dir (default $TMPDIR or /tmp) when it does not fit
+    if (options.count("max-memory")) {
+        uint64_t maxPrime = std::stoull(argv[1]);
+        if (maxPrime > UINT32_MAX) {
+            std::cerr << "Memory budget mode supports numbers below 2^32" << std::endl;
+            return 1;
+        }
+        BoundedMemorySieve::Plan plan;
+        if (!BoundedMemorySieve::plan(maxPrime, BoundedMemorySieve::parseBytes(options["max-memory"]), plan)) {
+            std::cerr << "Memory budget " << options["max-memory"] << " is too small" << std::endl;
+            return 1;
+        }
+        const char* tmpDirectory = std::getenv("TMPDIR");
+        std::string spillDirectory = options.count("spill-dir") ? options["spill-dir"] : (tmpDirectory != nullptr ? tmpDirectory : "/tmp");
+        BoundedMemorySieve::Result result;
+        if (!BoundedMemorySieve::run(maxPrime, plan, spillDirectory, result)) {
+            return 1;
+        }
+        uint32_t lastPrime = 0;
+        if (result.size() != 0) {
+            if (!result.back(lastPrime)) {
+                return 1;
+            }
+            std::cout << lastPrime << std::endl;
+        }
+        return 0;
+    }
+
+    // --nth: treat the argument as n and print the n-th prime generated lazily
+    if (options.count("nth")) {
+        uint64_t n = std::stoull(argv[1]);
+        if (n == 0) {
+            return 0;
+        }
+        PrimeGenerator generator;
+        uint64_t prime = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            prime = generator.next();
+        }
+        std::cout << prime << std::endl;
+        return 0;
+    }
+
+    // --pipelined[=ringDepth]: stream primes in order from the pipelined sieve
+    if (options.count("pipelined")) {
+        int numThreads = AutoTuner::settings().threads;
+        size_t ringDepth = options["pipelined"].empty() ? 4 * numThreads : std::stoul(options["pipelined"]);
+        uint64_t lastPrime = 0;
+        PipelinedSieve::run(std::stoull(argv[1]), [&lastPrime](uint64_t prime) { lastPrime = prime; },
+                            numThreads, ringDepth);
+        if (lastPrime != 0) {
+            std::cout << lastPrime << std::endl;
+        }
+        return 0;
+    }
+
+    // --engine=eratosthenes|atkin selects the sieve backend, --count prints the number of primes up to the
+    // argument (64-bit values allowed) instead of the largest one, --from=low sets the lower bound of the count
+    std::string engine = options.count("engine") ? options["engine"] : "eratosthenes";
+    if (engine != "eratosthenes" && engine != "atkin") {
+        std::cerr << "Unknown engine: " << engine << std::endl;
+        return 1;
+    }
+    if (options.count("count")) {
+        uint64_t high = std::stoull(argv[1]);
+        uint64_t low = options.count("from") ? std::stoull(options["from"]) : 0;
+        if (engine == "atkin" && high >= AtkinCalculator::kMaxHigh) {
+            std::cerr << "Atkin engine supports numbers below 2^62" << std::endl;
+            return 1;
+        }
+        uint64_t count = engine == "atkin" ? AtkinCalculator::countPrimes(low, high) : PrimeCalculator::countPrimes(low, high);
+        std::cout << count << std::endl;
+        return 0;
+    }
+
+    // --analytics [--from=low]: constellation counts, first occurrences and gap histogram of primes in [low, maxPrime]
+    if (options.count("analytics")) {
+        uint64_t low = options.count("from") ? std::stoull(options["from"]) : 0;
+        PrimeAnalytics::Result result = PrimeAnalytics::analyse(low, std::stoull(argv[1]));
+        std::cout << "primes: " << result.primesCount;
+        if (result.primesCount != 0) {
+            std::cout << " (from " << result.firstPrime << " to " << result.lastPrime << ")";
+        }
+        std::cout << std::endl;
+        for (size_t i = 0; i < PrimeAnalytics::patterns().size(); ++i) {
+            std::cout << PrimeAnalytics::patterns()[i].name << ": " << result.patternCounts[i];
+            if (result.patternCounts[i] != 0) {
+                std::cout << " (first p = " << result.patternFirst[i] << ")";
+            }
+            std::cout << std::endl;
+        }
+        if (result.maxGap != 0) {
+            std::cout << "max gap: " << result.maxGap << " (after " << result.maxGapStart << ")" << std::endl;
+        }
+        std::cout << "gap histogram:" << std::endl;
+        for (size_t gap = 0; gap < result.gapHistogram.size(); ++gap) {
+            if (result.gapHistogram[gap] != 0) {
+                std::cout << "  " << gap << ": " << result.gapHistogram[gap] << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    // --sum: exact sum of primes up to the argument, --power-sum=k --modulo=m: sum of p^k modulo m (k from 0 to 3),
+    // --check additionally recomputes the value with the pipelined sieve (meant for small arguments)
+    if (options.count("sum") || options.count("power-sum")) {
+        uint64_t n = std::stoull(argv[1]);
+        int power = options.count("power-sum") ? std::stoi(options["power-sum"]) : 1;
+        uint64_t modulus = options.count("modulo") ? std::stoull(options["modulo"]) : 0;
+        if (options.count("power-sum") && (power < 0 || power > 3 || modulus == 0)) {
+            std::cerr << "--power-sum supports powers from 0 to 3 and needs --modulo=m with m > 0" << std::endl;
+            return 1;
+        }
+        unsigned __int128 sum = options.count("power-sum") ? PrimeSums::powerSumModulo(n, power, modulus) : PrimeSums::sumPrimes(n);
+        std::cout << toString(sum) << std::endl;
+
+        if (options.count("check")) {
+            unsigned __int128 sieveSum = 0;
+            PipelinedSieve::run(n, [&](uint64_t prime) {
+                unsigned __int128 term = 1;
+                for (int i = 0; i < power; ++i) {
+                    term *= prime;
+                }
+                sieveSum += term;
+                if (modulus != 0) {
+                    sieveSum %= modulus;
+                }
+            }, AutoTuner::settings().threads, 16);
+            std::cout << "check: " << (sieveSum == sum ? "ok" : "failed, sieve gives " + toString(sieveSum)) << std::endl;
+            return sieveSum == sum ? 0 : 1;
+        }
+        return 0;
+    }
+
+    // --factorize: read numbers up to the argument from stdin and print their prime factors
+    // using a smallest prime factor table built up to the argument
+    if (options.count("factorize")) {
+        uint64_t limit = std::stoull(argv[1]);
+        if (limit > UINT32_MAX) {
+            std::cerr << "Factorisation supports numbers below 2^32" << std::endl;
+            return 1;
+        }
+        std::vector<uint32_t> values;
+        uint64_t value;
+        while (std::cin >> value) {
+            if (value > limit) {
+                std::cerr << value << " exceeds factorisation limit " << limit << std::endl;
+                return 1;
+            }
+            values.push_back(static_cast<uint32_t>(value));
+        }
+        SmallestPrimeFactorTable table(static_cast<uint32_t>(limit));
+        SmallestPrimeFactorTable::Factorization factorization;
+        if (!table.factorize(values, factorization)) {
+            std::cerr << "Too many prime factors for one batch (2^32 or more)" << std::endl;
+            return 1;
+        }
+        std::string output;
+        for (size_t i = 0; i < values.size(); ++i) {
+            output += std::to_string(values[i]) + ":";
+            for (uint32_t j = factorization.offsets[i]; j < factorization.offsets[i + 1]; ++j) {
+                output += " " + std::to_string(factorization.factors[j]);
+            }
+            output += "\n";
+        }
+        std::cout << output;
+        return 0;
+    }
+
+    std::vector<int> primeNumbers = engine == "atkin" ? AtkinCalculator::getPrimes(std::stoi(argv[1]))
+                                                      : PrimeCalculator::getPrimes(std::stoi(argv[1]));
     if (!primeNumbers.empty()) {
         std::cout << primeNumbers.back() << std::endl;
     };